@@ -0,0 +1,108 @@
+//
+// Runtime selection of the GEMM kernels, see kernel_registry.h
+//
+
+#include "kernel_registry.h"
+#include "smm_gem.h"
+#include <algorithm>
+
+#if SA_SIZE != 4 && SA_SIZE != 8 && SA_SIZE != 16 && SA_SIZE != 32
+#error "SA_SIZE must be one of the SA sizes of the kernels (4, 8, 16 or 32)"
+#endif
+
+struct KernelEntry {
+    KernelBackend backend;
+    int sa_size; // 0 if the kernel does not depend on it
+    GemmRWMA rwma;
+    GemmBWMA bwma;
+};
+
+static const KernelEntry kernels[] = {
+        {BACKEND_SA, 4, smmComputeRWMA<4>, smmComputeBWMA<4>},
+        {BACKEND_SA, 8, smmComputeRWMA<8>, smmComputeBWMA<8>},
+        {BACKEND_SA, 16, smmComputeRWMA<16>, smmComputeBWMA<16>},
+        {BACKEND_SA, 32, smmComputeRWMA<32>, smmComputeBWMA<32>},
+#ifdef SIMD
+        // The NEON kernels work on 16x16 int8 tiles whatever the SA size
+        {BACKEND_SIMD, 0, simdComputeRWMA, simdComputeBWMA},
+#endif
+};
+
+static const KernelEntry *findKernel(const KernelConfig &config) {
+    for (const KernelEntry &entry : kernels) {
+        if (entry.backend == config.backend && (entry.sa_size == 0 || entry.sa_size == config.sa_size))
+            return &entry;
+    }
+    return nullptr;
+}
+
+KernelConfig KernelRegistry::config_ = KernelRegistry::defaultConfig();
+GemmRWMA KernelRegistry::rwma_ = findKernel(KernelRegistry::config_)->rwma;
+GemmBWMA KernelRegistry::bwma_ = findKernel(KernelRegistry::config_)->bwma;
+
+KernelConfig KernelRegistry::defaultConfig() {
+    KernelConfig config{};
+#ifdef SIMD
+    config.backend = BACKEND_SIMD;
+#else
+    config.backend = BACKEND_SA;
+#endif
+#ifdef BWMA
+    config.bwma = true;
+#else
+    config.bwma = false;
+#endif
+    config.sa_size = SA_SIZE;
+    config.core_num = CORE_NUM;
+    return config;
+}
+
+bool KernelRegistry::select(const KernelConfig &config) {
+    const KernelEntry *entry = findKernel(config);
+    if (entry == nullptr || config.core_num < 1 || config.core_num > MAX_CORE_NUM)
+        return false;
+    config_ = config;
+    rwma_ = entry->rwma;
+    bwma_ = entry->bwma;
+    setCoreNum(config.core_num);
+    return true;
+}
+
+const KernelConfig &KernelRegistry::config() {
+    return config_;
+}
+
+std::string KernelRegistry::available() {
+    std::string names;
+    for (const KernelEntry &entry : kernels) {
+        if (!names.empty())
+            names += " ";
+        names += entry.backend == BACKEND_SA ? "sa" + std::to_string(entry.sa_size) : "simd";
+    }
+    return names;
+}
+
+std::size_t KernelRegistry::computeLength(std::size_t valid_len, std::size_t seq_len, std::size_t head_size) {
+    std::size_t tile = (config_.backend == BACKEND_SIMD) ? 16 : config_.sa_size;
+    for (std::size_t length = std::max(tile, (valid_len + tile - 1) / tile * tile); length < seq_len;
+         length += tile) {
+        // The row-wise SA kernel tiles the key and value GEMMs of the attention, whose weights have length rows
+        // or columns, by L1/L2 blocks; the other kernels only need whole tiles.
+        if (config_.backend != BACKEND_SA || config_.bwma ||
+            (smmTilesRWMA(head_size, length, config_.sa_size) && smmTilesRWMA(length, head_size, config_.sa_size)))
+            return length;
+    }
+    return seq_len;
+}
+
+void KernelRegistry::computeRWMA(std::size_t seq_len, const uint32_t *input, uint32_t *output, uint32_t *weights,
+                                 std::size_t input_size_, std::size_t output_size_, std::size_t output_row_size,
+                                 const int32_t *bias, const int8_t *activation) {
+    rwma_(seq_len, input, output, weights, input_size_, output_size_, output_row_size, bias, activation);
+}
+
+void KernelRegistry::computeBWMA(std::size_t seq_len, const uint32_t *input, uint32_t *output, uint32_t *weights,
+                                 std::size_t input_size_, std::size_t output_size_, const int32_t *bias,
+                                 const int8_t *activation, std::size_t batch) {
+    bwma_(seq_len, input, output, weights, input_size_, output_size_, bias, activation, batch);
+}
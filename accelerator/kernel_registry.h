@@ -0,0 +1,63 @@
+//
+// Runtime selection of the GEMM kernels. Every kernel stays specialized at compile time (e.g. the SA kernels for
+// each SA size); the registry maps a KernelConfig to the matching specialization, so that one binary covers all
+// the backends, memory arrangements, SA sizes and core counts it was compiled with.
+//
+
+#ifndef FVLLMONTITRANSFORMER_KERNEL_REGISTRY_H
+#define FVLLMONTITRANSFORMER_KERNEL_REGISTRY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+enum KernelBackend {
+    BACKEND_SA,   // systolic array instructions
+    BACKEND_SIMD, // NEON (only in the builds with -DSIMD)
+};
+
+struct KernelConfig {
+    KernelBackend backend;
+    bool bwma;     // block-wise memory arrangement, row-wise otherwise
+    int sa_size;
+    int core_num;
+};
+
+typedef void (*GemmRWMA)(std::size_t seq_len, const uint32_t *input, uint32_t *output, uint32_t *weights,
+                         std::size_t input_size_, std::size_t output_size_, std::size_t output_row_size,
+                         const int32_t *bias, const int8_t *activation);
+typedef void (*GemmBWMA)(std::size_t seq_len, const uint32_t *input, uint32_t *output, uint32_t *weights,
+                         std::size_t input_size_, std::size_t output_size_, const int32_t *bias,
+                         const int8_t *activation, std::size_t batch);
+
+class KernelRegistry {
+public:
+    // The configuration of the compile-time flags (-DSIMD, -DBWMA, -DSA_SIZE, -DCORE_NUM)
+    static KernelConfig defaultConfig();
+    // Selects the kernels of the configuration. Returns false, and keeps the current ones, if this binary does not
+    // have them.
+    static bool select(const KernelConfig &config);
+    static const KernelConfig &config();
+    // The kernels available in this binary, e.g. "sa4 sa8 sa16 sa32 simd"
+    static std::string available();
+
+    // Shortest number of rows, at least valid_len and at most seq_len, that the selected kernels tile without
+    // remainder in every GEMM of a layer (head_size is the width of the attention heads). The rows past it are
+    // padding that the layers do not need to compute.
+    static std::size_t computeLength(std::size_t valid_len, std::size_t seq_len, std::size_t head_size);
+
+    // Signatures of smmComputeRWMA / smmComputeBWMA (see smm_gem.h)
+    static void computeRWMA(std::size_t seq_len, const uint32_t *input, uint32_t *output, uint32_t *weights,
+                            std::size_t input_size_, std::size_t output_size_, std::size_t output_row_size = 0,
+                            const int32_t *bias = nullptr, const int8_t *activation = nullptr);
+    static void computeBWMA(std::size_t seq_len, const uint32_t *input, uint32_t *output, uint32_t *weights,
+                            std::size_t input_size_, std::size_t output_size_, const int32_t *bias = nullptr,
+                            const int8_t *activation = nullptr, std::size_t batch = 1);
+
+private:
+    static KernelConfig config_;
+    static GemmRWMA rwma_;
+    static GemmBWMA bwma_;
+};
+
+#endif //FVLLMONTITRANSFORMER_KERNEL_REGISTRY_H
@@ -0,0 +1,273 @@
+//
+// Trace of the SA instructions, see sa_trace.h
+//
+
+#include "sa_trace.h"
+#include "smm_gem.h"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+
+#define SA_TRACE_VERSION 1
+#define SA_TRACE_RECORD_BYTES 6
+// A core writes its records once it has this many bytes
+#define SA_TRACE_FLUSH_BYTES (1 << 20)
+// Longest time between two instructions of a span of the timeline
+#define SA_TIMELINE_GAP_NS 1000
+
+bool SaTrace::active_ = false;
+
+static std::FILE *trace_file = nullptr;
+static std::mutex trace_mutex;
+static std::vector<uint8_t> buffers[MAX_CORE_NUM];
+
+static void put16(std::vector<uint8_t> &bytes, uint32_t value) {
+    bytes.push_back((uint8_t) value);
+    bytes.push_back((uint8_t) (value >> 8));
+}
+
+static void put32(std::vector<uint8_t> &bytes, uint32_t value) {
+    put16(bytes, value & 0xffff);
+    put16(bytes, value >> 16);
+}
+
+static uint32_t get16(const uint8_t *bytes) {
+    return bytes[0] | (uint32_t) bytes[1] << 8;
+}
+
+static uint32_t get32(const uint8_t *bytes) {
+    return get16(bytes) | get16(bytes + 2) << 16;
+}
+
+static void writeChunk(int core, SaTraceChunk kind, const std::vector<uint8_t> &records) {
+    std::vector<uint8_t> header;
+    put16(header, core);
+    put16(header, kind);
+    put32(header, (uint32_t) (records.size() / SA_TRACE_RECORD_BYTES));
+    std::fwrite(header.data(), 1, header.size(), trace_file);
+    if (!records.empty())
+        std::fwrite(records.data(), 1, records.size(), trace_file);
+}
+
+bool SaTrace::open(const std::string &path, int sa_size, int core_num) {
+#ifndef DEVELOP
+    std::cerr << "The SA instructions are only traced by the host model of the SA (DEVELOP builds)" << std::endl;
+    return false;
+#else
+    close();
+    trace_file = std::fopen(path.c_str(), "wb");
+    if (trace_file == nullptr) {
+        std::cerr << "Error opening SA trace file: " << path << std::endl;
+        return false;
+    }
+    std::vector<uint8_t> header = {'S', 'A', 'T', 'R'};
+    put16(header, SA_TRACE_VERSION);
+    put16(header, sa_size);
+    put16(header, core_num);
+    put16(header, 0);
+    std::fwrite(header.data(), 1, header.size(), trace_file);
+    active_ = true;
+    return true;
+#endif
+}
+
+void SaTrace::close() {
+    if (trace_file == nullptr)
+        return;
+    barrier();
+    std::fclose(trace_file);
+    trace_file = nullptr;
+    active_ = false;
+}
+
+void SaTrace::record(int tid, SaTraceOp op, uint32_t index, uint32_t value) {
+    std::vector<uint8_t> &buffer = buffers[tid];
+    put16(buffer, (uint32_t) op << 14 | (index & 0x3fff));
+    put32(buffer, value);
+    if (buffer.size() >= SA_TRACE_FLUSH_BYTES)
+        flush(tid);
+}
+
+void SaTrace::flush(int tid) {
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    if (!buffers[tid].empty())
+        writeChunk(tid, SA_CHUNK_OPS, buffers[tid]);
+    buffers[tid].clear();
+}
+
+void SaTrace::barrier() {
+    if (!active_)
+        return;
+    bool written = false;
+    for (int tid = 0; tid < MAX_CORE_NUM; tid++) {
+        written |= !buffers[tid].empty();
+        flush(tid);
+    }
+    // A GEMM without instructions (e.g. the NEON kernels) does not synchronize anything
+    if (written)
+        writeChunk(0xffff, SA_CHUNK_BARRIER, {});
+}
+
+namespace {
+
+struct SaSpan {
+    SaState state;
+    uint64_t start; // ns since the timeline was opened
+    uint64_t end;
+};
+
+struct RegionEvent {
+    std::string name;
+    uint64_t time;
+    bool begin;
+};
+
+const char *const state_names[SA_STATE_NUM] = {"load", "stream", "drain"};
+
+std::string timeline_path;
+std::chrono::steady_clock::time_point timeline_origin;
+std::vector<SaSpan> spans[MAX_CORE_NUM];
+bool span_open[MAX_CORE_NUM];
+bool row_non_zero[MAX_CORE_NUM];
+std::vector<RegionEvent> regions;
+
+uint64_t timelineNow() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - timeline_origin)
+            .count();
+}
+
+// Extends the current span of the core, or starts a new one
+void advance(int tid, SaState state) {
+    uint64_t now = timelineNow();
+    std::vector<SaSpan> &core = spans[tid];
+    if (span_open[tid] && core.back().state == state && now - core.back().end <= SA_TIMELINE_GAP_NS) {
+        core.back().end = now;
+        return;
+    }
+    core.push_back({state, now, now});
+    span_open[tid] = true;
+}
+
+} // namespace
+
+bool SaTimeline::active_ = false;
+
+bool SaTimeline::open(const std::string &path) {
+#ifndef DEVELOP
+    std::cerr << "The SA timeline is only recorded by the host model of the SA (DEVELOP builds)" << std::endl;
+    return false;
+#else
+    close();
+    timeline_path = path;
+    timeline_origin = std::chrono::steady_clock::now();
+    for (int tid = 0; tid < MAX_CORE_NUM; tid++) {
+        spans[tid].clear();
+        span_open[tid] = false;
+        row_non_zero[tid] = false;
+    }
+    regions.clear();
+    active_ = true;
+    return true;
+#endif
+}
+
+void SaTimeline::close() {
+    if (!active_)
+        return;
+    active_ = false;
+    std::ofstream file(timeline_path);
+    if (!file) {
+        std::cerr << "Error writing the SA timeline: " << timeline_path << std::endl;
+        return;
+    }
+    // Chrome trace events, in microseconds: a track per core, and one for the regions of interest
+    file << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [" << std::endl;
+    file << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": " << MAX_CORE_NUM
+         << ", \"args\": {\"name\": \"regions\"}}";
+    for (int tid = 0; tid < MAX_CORE_NUM; tid++) {
+        if (spans[tid].empty())
+            continue;
+        file << "," << std::endl << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": " << tid
+             << ", \"args\": {\"name\": \"SA core " << tid << "\"}}";
+        for (const SaSpan &span : spans[tid]) {
+            file << "," << std::endl << "{\"name\": \"" << state_names[span.state]
+                 << "\", \"cat\": \"sa\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << tid << ", \"ts\": "
+                 << 1e-3 * (double) span.start << ", \"dur\": " << 1e-3 * (double) (span.end - span.start) << "}";
+        }
+    }
+    for (const RegionEvent &event : regions) {
+        std::string leaf = event.name.substr(event.name.rfind('/') + 1);
+        file << "," << std::endl << "{\"name\": \"" << leaf << "\", \"cat\": \"roi\", \"ph\": \""
+             << (event.begin ? "B" : "E") << "\", \"pid\": 0, \"tid\": " << MAX_CORE_NUM << ", \"ts\": "
+             << 1e-3 * (double) event.time << ", \"args\": {\"path\": \"" << event.name << "\"}}";
+    }
+    file << std::endl << "]}" << std::endl;
+}
+
+void SaTimeline::paramWrite(int tid) {
+    advance(tid, SA_STATE_LOAD);
+}
+
+void SaTimeline::queue(int tid, uint32_t value) {
+    // The words of a row are queued before its beat, which decides whether the row was an input
+    row_non_zero[tid] |= value != 0;
+    SaState state = (span_open[tid] && spans[tid].back().state != SA_STATE_LOAD) ? spans[tid].back().state
+                                                                                  : SA_STATE_STREAM;
+    advance(tid, row_non_zero[tid] ? SA_STATE_STREAM : state);
+}
+
+void SaTimeline::stream(int tid, uint32_t value) {
+    advance(tid, (row_non_zero[tid] || value != 0) ? SA_STATE_STREAM : SA_STATE_DRAIN);
+    row_non_zero[tid] = false;
+}
+
+void SaTimeline::region(const std::string &name, bool begin) {
+    if (active_)
+        regions.push_back({name, timelineNow(), begin});
+}
+
+SaTraceReader::~SaTraceReader() {
+    if (file_ != nullptr)
+        std::fclose(file_);
+}
+
+bool SaTraceReader::open(const std::string &path) {
+    file_ = std::fopen(path.c_str(), "rb");
+    if (file_ == nullptr) {
+        std::cerr << "Error opening SA trace file: " << path << std::endl;
+        return false;
+    }
+    uint8_t header[12];
+    if (std::fread(header, 1, sizeof(header), file_) != sizeof(header) || std::string((char *) header, 4) != "SATR" ||
+        get16(header + 4) != SA_TRACE_VERSION) {
+        std::cerr << "Not an SA trace (version " << SA_TRACE_VERSION << "): " << path << std::endl;
+        return false;
+    }
+    sa_size_ = (int) get16(header + 6);
+    core_num_ = (int) get16(header + 8);
+    return true;
+}
+
+bool SaTraceReader::nextSegment(std::vector<std::vector<SaTraceRecord>> &cores) {
+    cores.assign(core_num_, {});
+    bool found = false;
+    uint8_t header[8];
+    std::vector<uint8_t> bytes;
+    while (std::fread(header, 1, sizeof(header), file_) == sizeof(header)) {
+        found = true;
+        int core = (int) get16(header);
+        if (get16(header + 2) == SA_CHUNK_BARRIER)
+            break;
+        bytes.resize((std::size_t) get32(header + 4) * SA_TRACE_RECORD_BYTES);
+        if (std::fread(bytes.data(), 1, bytes.size(), file_) != bytes.size() || core >= core_num_) {
+            std::cerr << "Truncated or invalid SA trace" << std::endl;
+            return false;
+        }
+        for (std::size_t i = 0; i < bytes.size(); i += SA_TRACE_RECORD_BYTES) {
+            uint32_t code = get16(&bytes[i]);
+            cores[core].push_back({(uint8_t) (code >> 14), (uint16_t) (code & 0x3fff), get32(&bytes[i + 2])});
+        }
+    }
+    return found;
+}
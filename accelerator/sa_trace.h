@@ -0,0 +1,104 @@
+//
+// Trace of the SA instructions (smmParamWrite, smmQueue, smmStream) issued by each core, recorded by the host model
+// of the SA in DEVELOP builds, and read back by tools/saReplay.cc to study the accelerator without a gem5 run.
+//
+// File format (little-endian):
+//   header: "SATR", u16 version, u16 SA size, u16 cores, u16 0
+//   chunks: u16 core, u16 kind, u32 count, then count records of 6 bytes if kind is SA_CHUNK_OPS:
+//           u16 (operation << 14 | index), u32 value
+// A chunk of kind SA_CHUNK_BARRIER (core 0xffff, no records) marks the end of a parallel GEMM: the cores wait for
+// each other there. The chunks of a core are in the order of its instructions; the cores are interleaved.
+//
+// The host model can also record a timeline of the state of the SA of each core (SaTimeline), in the JSON format of
+// the Chrome trace viewer and Perfetto, with the regions of interest (roi.h) on a track of their own.
+//
+
+#ifndef FVLLMONTITRANSFORMER_SA_TRACE_H
+#define FVLLMONTITRANSFORMER_SA_TRACE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+enum SaTraceOp {
+    SA_OP_PARAM_WRITE, // index: weight index
+    SA_OP_QUEUE,       // index: column of the input word
+    SA_OP_STREAM,
+};
+
+enum SaTraceChunk {
+    SA_CHUNK_OPS,
+    SA_CHUNK_BARRIER,
+};
+
+struct SaTraceRecord {
+    uint8_t op;
+    uint16_t index;
+    uint32_t value;
+};
+
+class SaTrace {
+public:
+    // Records the instructions of the SA kernels into path until close(). Only the host model of the SA records
+    // them: returns false in gem5 builds, or if the file cannot be written.
+    static bool open(const std::string &path, int sa_size, int core_num);
+    static void close();
+    static bool active() { return active_; }
+
+    // Called by the instruction wrappers of core tid (one thread per core)
+    static void record(int tid, SaTraceOp op, uint32_t index, uint32_t value);
+    // Called by a single thread once the cores of a parallel GEMM are done
+    static void barrier();
+
+private:
+    static void flush(int tid);
+
+    static bool active_;
+};
+
+// States of the timeline of an SA
+enum SaState {
+    SA_STATE_LOAD,   // weights written
+    SA_STATE_STREAM, // beats with an input row
+    SA_STATE_DRAIN,  // beats without input: the drain of the SA, and the padding rows
+    SA_STATE_NUM,
+};
+
+class SaTimeline {
+public:
+    // Records the states of the SA of each core into path until close(). The instructions of a core closer than
+    // SA_TIMELINE_GAP_NS with the same state make one span: the SA is idle between the spans. Only the host model
+    // of the SA records them: returns false in gem5 builds (see the timeline parameter of the SA device instead).
+    static bool open(const std::string &path);
+    static void close();
+    static bool active() { return active_; }
+
+    // Called by the instruction wrappers of core tid
+    static void paramWrite(int tid);
+    static void queue(int tid, uint32_t value);
+    static void stream(int tid, uint32_t value);
+    // Begin and end of a region of interest, on the thread of the regions
+    static void region(const std::string &name, bool begin);
+
+private:
+    static bool active_;
+};
+
+// Reads a trace segment by segment: the instructions of each core between two barriers
+class SaTraceReader {
+public:
+    ~SaTraceReader();
+    bool open(const std::string &path);
+    int saSize() const { return sa_size_; }
+    int coreNum() const { return core_num_; }
+    // The records of each core until the next barrier (or the end of the trace). Returns false at the end.
+    bool nextSegment(std::vector<std::vector<SaTraceRecord>> &cores);
+
+private:
+    std::FILE *file_ = nullptr;
+    int sa_size_ = 0;
+    int core_num_ = 0;
+};
+
+#endif //FVLLMONTITRANSFORMER_SA_TRACE_H
@@ -4,6 +4,8 @@
 
 #include "iostream"
 #include "smm_gem.h"
+#include "sa_trace.h"
+#include <algorithm>
 #include <cmath>
 #include <omp.h>
 
@@ -16,17 +18,29 @@
 #endif
 
 #define W_DATA 4
-#define KERNEL_DIM SA_SIZE
-#define MAX_COL (SA_SIZE/W_DATA)
 #define mem2d(data, data_len, row, col)   data[((row)*(data_len))+(col)]
 
 
 void add8in32(uint32_t &memory, uint32_t &systolicResult);
+void epilogue8in32(uint32_t &memory, const int32_t *bias, const int8_t *lut);
 
 //#define DEVELOP
 
+static int core_num_ = CORE_NUM;
+
+void setCoreNum(int core_num) {
+    core_num_ = core_num;
+}
+
+int coreNum() {
+    return core_num_;
+}
+
 #ifndef DEVELOP
 
+// The SA device has a fixed size: the KERNEL_DIM template parameter of the instructions only selects the host
+// model in DEVELOP builds.
+
 /* CM Core Process (MVM)
 * Instruction format: |____Opcode___|__rm__|_X|__ra__|__rn__|__rd__|
 * Bits:               |31_________21|20__16|15|14__10|9____5|4____0|
@@ -41,6 +55,7 @@ void add8in32(uint32_t &memory, uint32_t &systolicResult);
 * -- rn = Parameter value.
 */
 
+template <int KERNEL_DIM>
 uint64_t smmStream(uint64_t rn, uint64_t tid=0) {
     uint64_t res;
 
@@ -70,6 +85,7 @@ uint64_t smmStream(uint64_t rn, uint64_t tid=0) {
 * -- ra = Thread index.
 * -- rn = Parameter value.
 */
+template <int KERNEL_DIM>
 uint64_t smmQueue(uint64_t rm, uint64_t rn, uint64_t tid=0) {
     uint64_t res;
 
@@ -100,6 +116,7 @@ uint64_t smmQueue(uint64_t rm, uint64_t rn, uint64_t tid=0) {
 * -- ra = Thread index.
 * -- rn = Parameter value.
  */
+template <int KERNEL_DIM>
 uint64_t smmParamWrite(uint64_t rm, uint64_t rn, int tid=0) {
     uint64_t res;
 
@@ -120,31 +137,50 @@ uint64_t smmParamWrite(uint64_t rm, uint64_t rn, int tid=0) {
 
 #else
 
-#include "systolic_m2m.hh"
+#include "systolic_m2m.h"
 
-SystolicMatrixMultiplication smm0 = SystolicMatrixMultiplication();
-SystolicMatrixMultiplication smm1 = SystolicMatrixMultiplication();
-SystolicMatrixMultiplication smm2 = SystolicMatrixMultiplication();
-SystolicMatrixMultiplication smm3 = SystolicMatrixMultiplication();
-SystolicMatrixMultiplication smmList[] = {smm0, smm1, smm2, smm3};
+// One host model per core and per SA size. The instructions are recorded while an SA trace or an SA timeline is open
+// (sa_trace.h).
+template <int KERNEL_DIM>
+SystolicMatrixMultiplication<KERNEL_DIM> smmList[MAX_CORE_NUM];
 
+template <int KERNEL_DIM>
 bool smmParamWrite(int rm, uint32_t ra, int tid) {
-    return smmList[tid].loadWeights(rm, ra);
+    if (SaTrace::active())
+        SaTrace::record(tid, SA_OP_PARAM_WRITE, rm, ra);
+    if (SaTimeline::active())
+        SaTimeline::paramWrite(tid);
+    return smmList<KERNEL_DIM>[tid].loadWeights(rm, ra);
 }
 
+template <int KERNEL_DIM>
 uint32_t smmQueue(int rm, uint32_t ra, int tid) {
-    return smmList[tid].inputQueue(rm, ra);
+    if (SaTrace::active())
+        SaTrace::record(tid, SA_OP_QUEUE, rm, ra);
+    if (SaTimeline::active())
+        SaTimeline::queue(tid, ra);
+    return smmList<KERNEL_DIM>[tid].inputQueue(rm, ra);
 }
 
+template <int KERNEL_DIM>
 uint32_t smmStream(uint32_t rn, int tid) {
-    return smmList[tid].streamInOut(rn);
+    if (SaTrace::active())
+        SaTrace::record(tid, SA_OP_STREAM, 0, rn);
+    if (SaTimeline::active())
+        SaTimeline::stream(tid, rn);
+    return smmList<KERNEL_DIM>[tid].streamInOut(rn);
 }
 
 #endif
 
 
+template <int KERNEL_DIM>
 void smmComputeRWMA(std::size_t seq_len, const uint32_t *input, uint32_t *output, uint32_t *weights,
-                    std::size_t input_size_, std::size_t output_size_) {
+                    std::size_t input_size_, std::size_t output_size_, std::size_t output_row_size,
+                    const int32_t *bias, const int8_t *activation) {
+    constexpr int MAX_COL = KERNEL_DIM / W_DATA;
+    // The output may be a column slice of a wider row-wise matrix (e.g. one head of the multi-head output)
+    std::size_t out_row_words = (output_row_size ? output_row_size : output_size_) / W_DATA;
 
     int ROWS_IN_BLOCK = std::min(128, (int) (seq_len));
     int rowMaxL1 = std::min(64, (int) (input_size_)) / KERNEL_DIM;
@@ -155,9 +191,10 @@ void smmComputeRWMA(std::size_t seq_len, const uint32_t *input, uint32_t *output
     int rowMaxL2 = std::min(256, (int) (input_size_)) / KERNEL_DIM / rowMaxL1;
     int colMaxL2 = std::min(256, (int) (output_size_)) / KERNEL_DIM / colMaxL1;
 
-    omp_set_num_threads(CORE_NUM); // set number of threads in "parallel" blocks
+    omp_set_num_threads(core_num_); // set number of threads in "parallel" blocks
 
-    int col_in_th = ROWS_IN_L2 / CORE_NUM;
+    // The row blocks are split in chunks across the cores; the last chunk may be shorter (or empty)
+    int col_in_th = (ROWS_IN_L2 + core_num_ - 1) / core_num_;
 
 #pragma omp parallel
     {
@@ -165,7 +202,11 @@ void smmComputeRWMA(std::size_t seq_len, const uint32_t *input, uint32_t *output
     for (int l2In = 0; l2In < (int) ceil((float) seq_len / (float) ROWS_IN_BLOCK / (float) ROWS_IN_L2); l2In++) {
         for (int l2Row = 0; l2Row < (input_size_ / KERNEL_DIM) / rowMaxL2 / rowMaxL1; l2Row++) {
             for (int l2Col = 0; l2Col < (output_size_ / KERNEL_DIM) / colMaxL2 / colMaxL1; l2Col++) {
-                for (int tileInL2 = omp_id*col_in_th; tileInL2 < (omp_id + 1) * col_in_th; tileInL2++) {
+                for (int tileInL2 = omp_id*col_in_th; tileInL2 < std::min((omp_id + 1) * col_in_th, ROWS_IN_L2);
+                     tileInL2++) {
+                    // The last L2 block of a short sequence has fewer row blocks
+                    if ((l2In * ROWS_IN_L2 + tileInL2) * ROWS_IN_BLOCK >= (int) seq_len)
+                        break;
                     for (int tileRowL2 = 0; tileRowL2 < rowMaxL2; tileRowL2++) {
                         for (int tileColL2 = 0; tileColL2 < colMaxL2; tileColL2++) {
                             for (int tileRowL1 = 0; tileRowL1 < rowMaxL1; tileRowL1++) {
@@ -183,7 +224,7 @@ void smmComputeRWMA(std::size_t seq_len, const uint32_t *input, uint32_t *output
                                         for (int j = colStart; j < colStart + colBlockSize; j++) {
                                             uint32_t weight = *(wPtr + j);
                                             int weight_idx = (i - rowStart) * KERNEL_DIM + (j - colStart) * W_DATA;
-                                            smmParamWrite(weight_idx, weight, omp_id);
+                                            smmParamWrite<KERNEL_DIM>(weight_idx, weight, omp_id);
                                         }
                                         wPtr += output_size_ / W_DATA;
                                     }
@@ -193,23 +234,23 @@ void smmComputeRWMA(std::size_t seq_len, const uint32_t *input, uint32_t *output
                                     int seqBlockLen = std::min(ROWS_IN_BLOCK,
                                                                (int) (seq_len - seqBlockIdx * ROWS_IN_BLOCK));
                                     int outputIndex = 0;
-                                    uint32_t *outPtr = output + seqBlockIdx * ROWS_IN_BLOCK * (output_size_ / W_DATA);
+                                    uint32_t *outPtr = output + seqBlockIdx * ROWS_IN_BLOCK * out_row_words;
                                     uint32_t mult;
                                     const uint32_t *inPtr =
                                             input + base_col_idx + seqBlockIdx * ROWS_IN_BLOCK * (input_size_ / W_DATA);
                                     for (int i = 0; i < seqBlockLen; i++) {
                                         for (int j = 0; j < MAX_COL; j++) {
                                             if (j == MAX_COL - 1) {
-                                                mult = smmStream(*(inPtr + j), omp_id);
+                                                mult = smmStream<KERNEL_DIM>(*(inPtr + j), omp_id);
                                             } else {
-                                                mult = smmQueue(j % MAX_COL, *(inPtr + j), omp_id);
+                                                mult = smmQueue<KERNEL_DIM>(j % MAX_COL, *(inPtr + j), omp_id);
                                             }
 
                                             if ((i * MAX_COL + j) >=
                                                 (MAX_COL * (2 * KERNEL_DIM - 1) -
                                                  1)) {    // check if the output is valid
                                                 add8in32(
-                                                        mem2d(outPtr, output_size_ / W_DATA, outputIndex / colBlockSize,
+                                                        mem2d(outPtr, out_row_words, outputIndex / colBlockSize,
                                                               colStart + outputIndex % colBlockSize), mult);
                                                 outputIndex++;
                                             }
@@ -219,16 +260,27 @@ void smmComputeRWMA(std::size_t seq_len, const uint32_t *input, uint32_t *output
                                     for (int i = seqBlockLen * MAX_COL;
                                          i < MAX_COL * (seqBlockLen + 2 * KERNEL_DIM - 1) - 1; i++) {
                                         if ((i % MAX_COL) == MAX_COL - 1) {
-                                            mult = smmStream(0, omp_id);
+                                            mult = smmStream<KERNEL_DIM>(0, omp_id);
                                         } else {
-                                            mult = smmQueue(i % MAX_COL, 0, omp_id);
+                                            mult = smmQueue<KERNEL_DIM>(i % MAX_COL, 0, omp_id);
                                         }
                                         if (i >= (MAX_COL * (2 * KERNEL_DIM - 1) - 1)) { // check if the output is valid
-                                            add8in32(mem2d(outPtr, output_size_ / W_DATA, outputIndex / colBlockSize,
+                                            add8in32(mem2d(outPtr, out_row_words, outputIndex / colBlockSize,
                                                            colStart + outputIndex % colBlockSize), mult);
                                             outputIndex++;
                                         }
                                     }
+
+                                    // Epilogue: the output tile is final once the last row of weights is processed
+                                    if ((bias != nullptr || activation != nullptr) &&
+                                        rowStart + KERNEL_DIM >= (int) input_size_) {
+                                        for (int i = 0; i < seqBlockLen; i++) {
+                                            for (int j = colStart; j < colStart + colBlockSize; j++) {
+                                                epilogue8in32(mem2d(outPtr, out_row_words, i, j),
+                                                              bias ? bias + j * W_DATA : nullptr, activation);
+                                            }
+                                        }
+                                    }
                                 }
                             }
                         }
@@ -238,22 +290,34 @@ void smmComputeRWMA(std::size_t seq_len, const uint32_t *input, uint32_t *output
         }
     }
     }
+    SaTrace::barrier();
 }
 
-void smmComputeBWMA(std::size_t seq_len, uint32_t *input, uint32_t *output, uint32_t *weights,
-                    std::size_t input_size_, std::size_t output_size_) {
-    omp_set_num_threads(CORE_NUM); // set number of threads in "parallel" blocks
-uint32_t *inPtr;
+template <int KERNEL_DIM>
+void smmComputeBWMA(std::size_t seq_len, const uint32_t *input, uint32_t *output, uint32_t *weights,
+                    std::size_t input_size_, std::size_t output_size_, const int32_t *bias,
+                    const int8_t *activation, std::size_t batch) {
+    constexpr int MAX_COL = KERNEL_DIM / W_DATA;
+    omp_set_num_threads(core_num_); // set number of threads in "parallel" blocks
+const uint32_t *inPtr;
 uint32_t *outPtr;
 uint32_t* weightPtr;
 int rowBlockSize = KERNEL_DIM;
 int colBlockSize = KERNEL_DIM / W_DATA;
-int col_in_th = output_size_ / KERNEL_DIM /  CORE_NUM;
+// The column blocks are split in chunks across the cores; the last chunk may be shorter (or empty)
+int col_blocks = output_size_ / KERNEL_DIM;
+int col_in_th = (col_blocks + core_num_ - 1) / core_num_;
+// The sequences of the batch follow each other, each one in block-wise arrangement. They are streamed back to back
+// through each weight tile, so the tile is loaded once per batch.
+int rows = (int) (batch * seq_len);
+std::size_t in_seq_words = seq_len * input_size_ / W_DATA;
+std::size_t out_seq_words = seq_len * output_size_ / W_DATA;
+int out_block_words = MAX_COL * (int) seq_len;
 # pragma omp parallel private(inPtr, outPtr, weightPtr)
 {
     int id = omp_get_thread_num();
-    int start_index = col_in_th * id;
-    int end_index = start_index + col_in_th;
+    int start_index = std::min(col_in_th * id, col_blocks);
+    int end_index = std::min(start_index + col_in_th, col_blocks);
     weightPtr = weights + start_index * (input_size_ / KERNEL_DIM) * rowBlockSize * colBlockSize;
     for (int l2Col = start_index; l2Col < end_index; l2Col++) {
         for (int l2Row = 0; l2Row < input_size_ / KERNEL_DIM; l2Row++) {
@@ -261,44 +325,91 @@ int col_in_th = output_size_ / KERNEL_DIM /  CORE_NUM;
 
             for (int i = 0; i < rowBlockSize * colBlockSize; i++) {
                 uint32_t weight = *(weightPtr++);
-                smmParamWrite(i * W_DATA, weight, id);
+                smmParamWrite<KERNEL_DIM>(i * W_DATA, weight, id);
             }
             // Process the multiplication
             int base_col_idx = l2Row * MAX_COL * seq_len;
-            outPtr = output + l2Col * MAX_COL * seq_len;
+            uint32_t *outBase = output + l2Col * MAX_COL * seq_len;
+            outPtr = outBase;
+            int outputIndex = 0;
             uint32_t mult;
             inPtr = input + base_col_idx;
-            for (int i = 0; i < seq_len; i++) {
+            for (int i = 0; i < rows; i++) {
+                if (i > 0 && i % seq_len == 0)
+                    inPtr = input + (i / seq_len) * in_seq_words + base_col_idx;
                 for (int j = 0; j < MAX_COL; j++) {
-                    uint32_t content = *(inPtr);
                     if (j == MAX_COL - 1) {
-                        mult = smmStream(*(inPtr++), id);
+                        mult = smmStream<KERNEL_DIM>(*(inPtr++), id);
                     } else {
-                        mult = smmQueue(j % MAX_COL, *(inPtr++), id);
+                        mult = smmQueue<KERNEL_DIM>(j % MAX_COL, *(inPtr++), id);
                     }
 
                     if ((i * MAX_COL + j) >= (MAX_COL * (2 * KERNEL_DIM - 1) - 1)) {
                         // check if the output is valid
                         add8in32(*(outPtr++), mult);
+                        if (++outputIndex % out_block_words == 0)
+                            outPtr = outBase + (outputIndex / out_block_words) * out_seq_words;
                     }
                 }
             }
-            for (int i = seq_len * MAX_COL;
-                 i < MAX_COL * (seq_len + 2 * KERNEL_DIM - 1) - 1; i++) {
+            for (int i = rows * MAX_COL;
+                 i < MAX_COL * (rows + 2 * KERNEL_DIM - 1) - 1; i++) {
                 if ((i % MAX_COL) == MAX_COL - 1) {
-                    mult = smmStream(0, id);
+                    mult = smmStream<KERNEL_DIM>(0, id);
                 } else {
-                    mult = smmQueue(i % MAX_COL, 0, id);
+                    mult = smmQueue<KERNEL_DIM>(i % MAX_COL, 0, id);
                 }
                 if (i >= (MAX_COL * (2 * KERNEL_DIM - 1) - 1)) { // check if the output is valid
                     add8in32(*(outPtr++), mult);
+                    if (++outputIndex % out_block_words == 0)
+                        outPtr = outBase + (outputIndex / out_block_words) * out_seq_words;
+                }
+            }
+        }
+
+        // Epilogue: the column block is final once all the rows of weights are processed
+        if (bias != nullptr || activation != nullptr) {
+            for (std::size_t b = 0; b < batch; b++) {
+                outPtr = output + b * out_seq_words + l2Col * MAX_COL * seq_len;
+                for (std::size_t i = 0; i < seq_len; i++) {
+                    for (int j = 0; j < MAX_COL; j++) {
+                        epilogue8in32(*(outPtr++), bias ? bias + (l2Col * MAX_COL + j) * W_DATA : nullptr,
+                                      activation);
+                    }
                 }
             }
         }
     }
 }
+SaTrace::barrier();
+}
+
+bool smmTilesRWMA(std::size_t input_size_, std::size_t output_size_, int kernel_dim) {
+    // Same L1/L2 tiling as smmComputeRWMA
+    int rowMaxL1 = std::min(64, (int) (input_size_)) / kernel_dim;
+    int ratio = 64 / std::max(1, std::min(64, (int) (input_size_)));
+    int colMaxL1 = std::min(32 * ratio, (int) (output_size_)) / kernel_dim;
+    if (rowMaxL1 == 0 || colMaxL1 == 0)
+        return false;
+    int rowMaxL2 = std::min(256, (int) (input_size_)) / kernel_dim / rowMaxL1;
+    int colMaxL2 = std::min(256, (int) (output_size_)) / kernel_dim / colMaxL1;
+    return rowMaxL2 > 0 && colMaxL2 > 0 &&
+           input_size_ % (kernel_dim * rowMaxL1 * rowMaxL2) == 0 &&
+           output_size_ % (kernel_dim * colMaxL1 * colMaxL2) == 0;
 }
 
+// The SA kernels of every supported SA size (the table of KernelRegistry lists them)
+#define INSTANTIATE_SMM_COMPUTE(SIZE)                                                                             \
+    template void smmComputeRWMA<SIZE>(std::size_t, const uint32_t *, uint32_t *, uint32_t *, std::size_t,        \
+                                       std::size_t, std::size_t, const int32_t *, const int8_t *);               \
+    template void smmComputeBWMA<SIZE>(std::size_t, const uint32_t *, uint32_t *, uint32_t *, std::size_t,        \
+                                       std::size_t, const int32_t *, const int8_t *, std::size_t);
+
+INSTANTIATE_SMM_COMPUTE(4)
+INSTANTIATE_SMM_COMPUTE(8)
+INSTANTIATE_SMM_COMPUTE(16)
+INSTANTIATE_SMM_COMPUTE(32)
+
 void add8in32(uint32_t &memory, uint32_t &systolicResult) {
     /*
      * This function separates every 32-bit input to four 8-bit integers and add them. Then, packing again and
@@ -313,6 +424,24 @@ void add8in32(uint32_t &memory, uint32_t &systolicResult) {
     }
 }
 
+void epilogue8in32(uint32_t &memory, const int32_t *bias, const int8_t *lut) {
+    /*
+     * This function adds the per-channel bias of the four 8-bit integers packed in a 32-bit unsigned int, then
+     * applies an int8 lookup table (e.g. an activation function) to them. Both bias and lut are optional.
+     * Byte i of the word belongs to channel bias[i]; the int8 outputs wrap like the SA accumulation.
+     */
+    auto *mem_ptr = (int8_t *) (&memory);
+    for (int i = 0; i < W_DATA; i++) {
+        int8_t value = *mem_ptr;
+        if (bias != nullptr)
+            value = (int8_t) (value + bias[i]);
+        if (lut != nullptr)
+            value = lut[(uint8_t) value];
+        *mem_ptr = value;
+        mem_ptr++;
+    }
+}
+
 void conventionalCompute(std::size_t seq_len, const uint32_t *input, uint32_t *output, uint32_t *weight,
                          std::size_t input_size_, std::size_t output_size_) {
     for (int length = 0; length < seq_len; length++) {
@@ -417,7 +546,9 @@ bool is_all_zero_int8x16(int8x16_t vec) {
 
 
 void simdComputeRWMA(size_t seq_len, const uint32_t * input, uint32_t * output, uint32_t * weight,
-                 size_t input_size_, size_t output_size_) {
+                 size_t input_size_, size_t output_size_, size_t output_row_size, const int32_t *bias,
+                 const int8_t *activation) {
+    size_t out_row_size = output_row_size ? output_row_size : output_size_;
 
     int ROWS_IN_BLOCK = 16;
     int COLS_IN_BLOCK = 16;
@@ -451,7 +582,7 @@ void simdComputeRWMA(size_t seq_len, const uint32_t * input, uint32_t * output,
 
 
                 int8_t* output8_t = (int8_t * ) output;
-                int C_idx = ((l2_row_idx) * ROWS_IN_BLOCK) * output_size_ + (l2_col_idx) * COLS_IN_BLOCK ;
+                int C_idx = ((l2_row_idx) * ROWS_IN_BLOCK) * out_row_size + (l2_col_idx) * COLS_IN_BLOCK ;
 
                 //                bool print_bool = (l2_row_idx == 0 && l2_col_idx == 0 && l2_w_idx == 0);
                 int A_idx = ((l2_row_idx * ROWS_IN_BLOCK) * input_size_) +  (l2_w_idx) * COLS_IN_BLOCK ;
@@ -468,13 +599,24 @@ void simdComputeRWMA(size_t seq_len, const uint32_t * input, uint32_t * output,
 
                 for (int i = 0; i < 16; ++i) {
                     // Load current values from the output array
-                    int8x16_t curr_C = vld1q_s8(output8_t + C_idx + i * output_size_);
+                    int8x16_t curr_C = vld1q_s8(output8_t + C_idx + i * out_row_size);
 
                     // Add the new values to the current values
                     int8x16_t new_C = vaddq_s8(curr_C, C[i]);
 
                     // Store the updated values back into the output array
-                    vst1q_s8(output8_t + C_idx + i * output_size_, new_C);
+                    vst1q_s8(output8_t + C_idx + i * out_row_size, new_C);
+                }
+
+                // Epilogue: the output tile is final once the last row of weights is processed
+                if ((bias != nullptr || activation != nullptr) && l2_w_idx == COLS_IN_L2 - 1) {
+                    for (int i = 0; i < 16; ++i) {
+                        auto *out_word = (uint32_t *) (output8_t + C_idx + i * out_row_size);
+                        for (int j = 0; j < 16 / W_DATA; ++j) {
+                            epilogue8in32(out_word[j], bias ? bias + l2_col_idx * COLS_IN_BLOCK + j * W_DATA : nullptr,
+                                          activation);
+                        }
+                    }
                 }
 
             }
@@ -486,7 +628,8 @@ void simdComputeRWMA(size_t seq_len, const uint32_t * input, uint32_t * output,
 
 
 void simdComputeBWMA(size_t seq_len, const uint32_t * input, uint32_t * output, uint32_t * weight,
-                    size_t input_size_, size_t output_size_) {
+                    size_t input_size_, size_t output_size_, const int32_t *bias, const int8_t *activation,
+                    size_t batch) {
 
     int ROWS_IN_BLOCK = 16;
     int COLS_IN_BLOCK = 16;
@@ -496,6 +639,11 @@ void simdComputeBWMA(size_t seq_len, const uint32_t * input, uint32_t * output,
     int COLS_IN_L2 = (int) (input_size_ / COLS_IN_BLOCK);
     int W_COL_IN_L2 = (int) (output_size_ / W_COL_BLOCKS);
 
+    // The sequences of the batch follow each other (see smmComputeBWMA); the weight tile stays in the registers
+    // for all of them
+    size_t in_seq_bytes = seq_len * input_size_;
+    size_t out_seq_bytes = seq_len * output_size_;
+
     int8x16_t A[16];
     int8x16_t B[16];
     int8x16_t C[16];
@@ -509,46 +657,60 @@ void simdComputeBWMA(size_t seq_len, const uint32_t * input, uint32_t * output,
                 weight8_t += 16;
             }
 
-            int A_idx = l2_w_idx * COLS_IN_BLOCK * (int) seq_len ;
-            int8_t* input8_t = (int8_t * ) input + A_idx;
+            for (int b = 0; b < (int) batch; b++) {
+                int A_idx = l2_w_idx * COLS_IN_BLOCK * (int) seq_len ;
+                int8_t* input8_t = (int8_t * ) input + b * in_seq_bytes + A_idx;
 
-            int C_idx = l2_col_idx * COLS_IN_BLOCK * (int) seq_len ;
-            int8_t* output8_t = (int8_t *) output + C_idx;
+                int C_idx = l2_col_idx * COLS_IN_BLOCK * (int) seq_len ;
+                int8_t* output8_t = (int8_t *) output + b * out_seq_bytes + C_idx;
 
 
-            for (int l2_row_idx = 0; l2_row_idx < ROWS_IN_L2; l2_row_idx++) {
-
-                for (int i=0; i<16; i++)
-                    C[i]=vmovq_n_s8(0);
+                for (int l2_row_idx = 0; l2_row_idx < ROWS_IN_L2; l2_row_idx++) {
 
+                    for (int i=0; i<16; i++)
+                        C[i]=vmovq_n_s8(0);
 
-                for (int i=0; i<16; i++){
-                    A[i] = vld1q_s8(input8_t);
-                    input8_t += 16;
-                }
 
-                for (int k=0; k< 16; k++){
                     for (int i=0; i<16; i++){
-                        C[k] = vmlaq_s8(C[k], B[i], vmovq_n_s8(vgetq_lane_s8(A[k], 4*(i/4) +3-(i%4))));
+                        A[i] = vld1q_s8(input8_t);
+                        input8_t += 16;
                     }
-                }
 
-                for (int i = 0; i < 16; ++i) {
-                    // Load current values from the output array
-                    int8x16_t curr_C = vld1q_s8(output8_t);
+                    for (int k=0; k< 16; k++){
+                        for (int i=0; i<16; i++){
+                            C[k] = vmlaq_s8(C[k], B[i], vmovq_n_s8(vgetq_lane_s8(A[k], 4*(i/4) +3-(i%4))));
+                        }
+                    }
 
-                    // Add the new values to the current values
-                    int8x16_t new_C = vaddq_s8(curr_C, C[i]);
+                    for (int i = 0; i < 16; ++i) {
+                        // Load current values from the output array
+                        int8x16_t curr_C = vld1q_s8(output8_t);
 
-                    // Store the updated values back into the output array
-                    vst1q_s8(output8_t, new_C);
+                        // Add the new values to the current values
+                        int8x16_t new_C = vaddq_s8(curr_C, C[i]);
 
-                    output8_t += 16;
-                }
+                        // Store the updated values back into the output array
+                        vst1q_s8(output8_t, new_C);
 
+                        output8_t += 16;
+                    }
+
+                }
             }
 
         }
+
+        // Epilogue: the column block is final once all the rows of weights are processed
+        if (bias != nullptr || activation != nullptr) {
+            for (int b = 0; b < (int) batch; b++) {
+                uint32_t* out_word = output + b * (out_seq_bytes / W_DATA) +
+                                     l2_col_idx * (COLS_IN_BLOCK / W_DATA) * seq_len;
+                for (int i = 0; i < (COLS_IN_BLOCK / W_DATA) * (int) seq_len; i++) {
+                    epilogue8in32(out_word[i], bias ? bias + l2_col_idx * COLS_IN_BLOCK + (i % (COLS_IN_BLOCK / W_DATA)) * W_DATA
+                                                    : nullptr, activation);
+                }
+            }
+        }
     }
 }
 #endif
@@ -14,17 +14,39 @@ void conventionalCompute(std::size_t seq_len, const uint32_t * input, uint32_t *
 void tiledCompute(std::size_t seq_len, const uint32_t * input, uint32_t * output, uint32_t *weight,
                          std::size_t input_size_, std::size_t output_size_);
 
+// Largest number of cores with an SA (one host model each in DEVELOP builds)
+#define MAX_CORE_NUM 16
+
+// Number of cores the SA GEMMs are split across (CORE_NUM by default)
+void setCoreNum(int core_num);
+int coreNum();
+
+// The SA kernels are specialized for each SA size (KERNEL_DIM: 4, 8, 16 and 32); use them through KernelRegistry.
+// output_row_size is the row pitch of the output in int8 elements; 0 means a dense output of output_size_ columns.
+// bias (per output channel, int32) and activation (256-entry int8 lookup table) are optional and applied to each
+// output, in this order, once it is final (GEMM epilogue).
+// In BWMA, input and output hold batch sequences of seq_len rows one after the other, each in block-wise
+// arrangement; every weight tile is loaded once for the whole batch. In RWMA, a batch is simply batch * seq_len rows.
+template <int KERNEL_DIM>
 void smmComputeRWMA(std::size_t seq_len, const uint32_t *input, uint32_t *output, uint32_t *weights,
-                    std::size_t input_size_, std::size_t output_size_);
+                    std::size_t input_size_, std::size_t output_size_, std::size_t output_row_size = 0,
+                    const int32_t *bias = nullptr, const int8_t *activation = nullptr);
 
-void smmComputeBWMA(std::size_t seq_len, uint32_t *input, uint32_t *output, uint32_t *weights,
-                    std::size_t input_size_, std::size_t output_size_);
+template <int KERNEL_DIM>
+void smmComputeBWMA(std::size_t seq_len, const uint32_t *input, uint32_t *output, uint32_t *weights,
+                    std::size_t input_size_, std::size_t output_size_, const int32_t *bias = nullptr,
+                    const int8_t *activation = nullptr, std::size_t batch = 1);
+
+// True if the L1/L2 tiling of smmComputeRWMA covers the whole [input_size_, output_size_] weight matrix
+bool smmTilesRWMA(std::size_t input_size_, std::size_t output_size_, int kernel_dim);
 
 void simdComputeRWMA(std::size_t seq_len, const uint32_t *input, uint32_t *output, uint32_t *weights,
-                     std::size_t input_size_, std::size_t output_size_);
+                     std::size_t input_size_, std::size_t output_size_, std::size_t output_row_size = 0,
+                     const int32_t *bias = nullptr, const int8_t *activation = nullptr);
 
 void simdComputeBWMA(std::size_t seq_len, const uint32_t *input, uint32_t *output, uint32_t *weights,
-                     std::size_t input_size_, std::size_t output_size_);
+                     std::size_t input_size_, std::size_t output_size_, const int32_t *bias = nullptr,
+                     const int8_t *activation = nullptr, std::size_t batch = 1);
 
 
 #endif //FVLLMONTITRANSFORMER_SMM_GEM_H
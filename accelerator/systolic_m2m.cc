@@ -32,7 +32,8 @@
 #include <iostream>
 #include "systolic_m2m.h"
 
-bool SystolicMatrixMultiplication::loadWeights(int idx, uint32_t val) {
+template <int KERNEL_DIM>
+bool SystolicMatrixMultiplication<KERNEL_DIM>::loadWeights(int idx, uint32_t val) {
     for (int i=0; i < W_DATA; i++){
         auto currVal = (int8_t)((val >> (8 * (W_DATA -i-1))) & 0xff);
         weights[idx + i] = currVal;
@@ -42,7 +43,8 @@ bool SystolicMatrixMultiplication::loadWeights(int idx, uint32_t val) {
     return non_zero_tile;
 }
 
-uint32_t SystolicMatrixMultiplication::inputQueue(int col, uint32_t val) {
+template <int KERNEL_DIM>
+uint32_t SystolicMatrixMultiplication<KERNEL_DIM>::inputQueue(int col, uint32_t val) {
     // Split the input to an array
     for (int i=0; i < W_DATA; i++){
         auto currVal = (int8_t)((val >> (8 * (W_DATA - i -1))) & 0xff);
@@ -59,11 +61,13 @@ uint32_t SystolicMatrixMultiplication::inputQueue(int col, uint32_t val) {
     return result;
 }
 
-void SystolicMatrixMultiplication::printWeights() {
+template <int KERNEL_DIM>
+void SystolicMatrixMultiplication<KERNEL_DIM>::printWeights() {
     std::cout << std::hex << (uint32_t) weights[0] << std::endl;
 }
 
-uint32_t SystolicMatrixMultiplication::streamInOut(uint32_t val) {
+template <int KERNEL_DIM>
+uint32_t SystolicMatrixMultiplication<KERNEL_DIM>::streamInOut(uint32_t val) {
     non_zero_tile = false;
 	int col = MAX_COL - 1;
     // Split the input to an array
@@ -112,3 +116,8 @@ uint32_t SystolicMatrixMultiplication::streamInOut(uint32_t val) {
     return result;
 
 }
+
+template class SystolicMatrixMultiplication<4>;
+template class SystolicMatrixMultiplication<8>;
+template class SystolicMatrixMultiplication<16>;
+template class SystolicMatrixMultiplication<32>;
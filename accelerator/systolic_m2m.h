@@ -34,14 +34,16 @@
 #include <cstddef>
 #include <cstdint>
 
-#define KERNEL_DIM SA_SIZE
 #define W_DATA 4
-#define MAX_COL (SA_SIZE/W_DATA)
 
 #define mem2d(data,data_len,row,col)   data[((row)*(data_len))+(col)]
 
+// Host model of a KERNEL_DIM x KERNEL_DIM systolic array (instantiated for the SA sizes of the SA kernels)
+template <int KERNEL_DIM>
 class SystolicMatrixMultiplication {
   private:
+    static constexpr int MAX_COL = KERNEL_DIM / W_DATA;
+
     // System this ACM belongs to.
     int8_t weights[KERNEL_DIM * KERNEL_DIM]{};
 
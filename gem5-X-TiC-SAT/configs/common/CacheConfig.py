@@ -92,8 +92,26 @@ def config_cache(options, system):
 
         system.tol2bus = L2XBar(clk_domain = system.cpu_clk_domain)
         system.tol2bus.width = options.l2bus_width
-        system.l2.cpu_side = system.tol2bus.master
-        system.l2.mem_side = system.membus.slave
+        if getattr(options, "tensor_traffic", False):
+            # Monitors on both sides of the L2 cache, binning the misses of
+            # the L1 caches and of the L2 cache per tensor of the application
+            system.l2_cpu_monitor = CommMonitor()
+            system.tol2bus.master = system.l2_cpu_monitor.slave
+            system.l2.cpu_side = system.l2_cpu_monitor.master
+            system.l2_mem_monitor = CommMonitor()
+            system.l2.mem_side = system.l2_mem_monitor.slave
+            system.l2_mem_monitor.master = system.membus.slave
+            system.l2_tensor_traffic = TensorTrafficProbe(
+                manager=[system.l2_cpu_monitor])
+            system.mem_tensor_traffic = TensorTrafficProbe(
+                manager=[system.l2_mem_monitor])
+        else:
+            system.l2.cpu_side = system.tol2bus.master
+            system.l2.mem_side = system.membus.slave
+
+    if getattr(options, "tensor_traffic", False) and not options.l2cache:
+        print("--tensor-traffic needs --l2cache.\n")
+        sys.exit(1)
 
     if options.memchecker:
         system.memchecker = MemChecker()
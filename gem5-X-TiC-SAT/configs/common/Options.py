@@ -100,6 +100,9 @@ def addNoISAOptions(parser):
                       help="use external port for SystemC TLM cosimulation")
     parser.add_option("--caches", action="store_true")
     parser.add_option("--l2cache", action="store_true")
+    parser.add_option("--tensor-traffic", action="store_true",
+                      help="Count the L2 and memory traffic of each tensor "\
+                      "registered with m5_tensor_register (needs --l2cache)")
     parser.add_option("--num-dirs", type="int", default=1)
     parser.add_option("--num-l2caches", type="int", default=1)
     parser.add_option("--num-l3caches", type="int", default=1)
@@ -291,6 +294,9 @@ def addCommonOptions(parser):
     parser.add_option("-s", "--standard-switch", action="store", type="int",
         default=None,
         help="switch from timing to Detailed CPU after warmup period of <N>")
+    parser.add_option("--roi-switch", action="store_true", default=False,
+        help="Run the atomic CPU outside the regions of interest of the "
+             "binary (m5 workbegin/workend) and the --cpu-type CPU inside")
     parser.add_option("-p", "--prog-interval", type="str",
         help="CPU Progress Interval")
 
@@ -370,6 +376,13 @@ def addFSOptions(parser):
                 "switches and dump tasks file (required for Streamline)")
         parser.add_option("--generate-dtb", action="store_true", default=False,
                     help="Automatically generate a dtb file")
+        parser.add_option("--sa-power", action="store_true", default=False,
+                    help="Attach a power model to the systolic arrays, fed "\
+                    "by their energy statistics")
+        parser.add_option("--sa-timeline", action="store", type="string",
+                    default="", help="Write the timeline of the systolic "\
+                    "arrays (Chrome trace) to this file of the output "\
+                    "directory")
 
     # Benchmark options
     parser.add_option("--dual", action="store_true",
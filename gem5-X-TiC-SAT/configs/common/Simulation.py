@@ -83,7 +83,7 @@ def setCPUClass(options):
             print("options.restore_with_cpu != options.cpu_type")
             CPUClass = TmpClass
             TmpClass, test_mem_mode = getCPUClass(options.restore_with_cpu)
-    elif options.fast_forward:
+    elif options.fast_forward or options.roi_switch:
         CPUClass = TmpClass
         TmpClass = AtomicSimpleCPU
         test_mem_mode = 'atomic'
@@ -124,6 +124,9 @@ def setWorkCountOptions(system, options):
         system.work_begin_ckpt_count = options.work_begin_checkpoint_count
     if options.work_cpus_checkpoint_count != None:
         system.work_cpus_ckpt_count = options.work_cpus_checkpoint_count
+    # The work items return to the script, which switches the CPUs
+    if options.roi_switch:
+        system.exit_on_work_items = True
 
 def findCptDir(options, cptdir, testsys):
     """Figures out the directory from which the checkpointed state is read.
@@ -438,6 +441,29 @@ def repeatSwitch(testsys, repeat_switch_cpu_list, maxtick, switch_freq):
             exit_event = m5.simulate(maxtick - m5.curTick())
             return exit_event
 
+def roiSwitch(testsys, switch_cpu_list, maxtick):
+    # Switch to the detailed CPUs at the beginning of each region of
+    # interest (work item) and back to the atomic ones at its end. The
+    # state of the systolic arrays is in their device, by thread index, so
+    # it is kept across the switches.
+    detailed = False
+    while True:
+        exit_event = m5.simulate(maxtick - m5.curTick())
+        exit_cause = exit_event.getCause()
+
+        if exit_cause not in ("workbegin", "workend"):
+            return exit_event
+        if (exit_cause == "workbegin") == detailed:
+            continue
+
+        m5.switchCpus(testsys, switch_cpu_list)
+        switch_cpu_list = [(new_cpu, old_cpu)
+                           for old_cpu, new_cpu in switch_cpu_list]
+        detailed = not detailed
+        print("Switched to the %s CPUs @ tick %s because of %s" %
+              ("detailed" if detailed else "atomic", m5.curTick(),
+               exit_cause))
+
 def run(options, root, testsys, cpu_class):
     if options.checkpoint_dir:
         cptdir = options.checkpoint_dir
@@ -458,6 +484,16 @@ def run(options, root, testsys, cpu_class):
     if options.repeat_switch and options.take_checkpoints:
         fatal("Can't specify both --repeat-switch and --take-checkpoints")
 
+    if options.roi_switch and (options.fast_forward or
+                               options.standard_switch or
+                               options.repeat_switch or
+                               options.checkpoint_restore != None):
+        fatal("Can't specify --roi-switch with --fast-forward, "
+              "--standard-switch, --repeat-switch or --checkpoint-restore")
+
+    if options.roi_switch and not cpu_class:
+        fatal("--roi-switch needs a --cpu-type other than the atomic CPU")
+
     np = options.num_cpus
     switch_cpus = None
 
@@ -675,7 +711,7 @@ def run(options, root, testsys, cpu_class):
         fatal("Bad maxtick (%d) specified: " \
               "Checkpoint starts starts from tick: %d", maxtick, cpt_starttick)
 
-    if options.standard_switch or cpu_class:
+    if (options.standard_switch or cpu_class) and not options.roi_switch:
         if options.standard_switch:
             print("Switch at instruction count:%s" %
                     str(testsys.cpu[0].max_insts_any_thread))
@@ -742,6 +778,8 @@ def run(options, root, testsys, cpu_class):
         if options.repeat_switch and maxtick > options.repeat_switch:
             exit_event = repeatSwitch(testsys, repeat_switch_cpu_list,
                                       maxtick, options.repeat_switch)
+        elif options.roi_switch:
+            exit_event = roiSwitch(testsys, switch_cpu_list, maxtick)
         else:
             exit_event = benchCheckpoints(options, maxtick, cptdir)
 
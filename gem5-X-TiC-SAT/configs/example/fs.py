@@ -74,6 +74,24 @@ def is_kvm_cpu(cpu_class):
     return have_kvm_support and cpu_class != None and \
         issubclass(cpu_class, BaseKvmCPU)
 
+# Power of the systolic arrays, from the energy of their activity and of
+# their idle cycles (see the energy parameters of SystolicMatrixMultiplication)
+class SaPowerOn(MathExprPowerModel):
+    dyn = "dynamicPower"
+    st = "idlePower"
+
+class SaPowerOff(MathExprPowerModel):
+    dyn = "0"
+    st = "0"
+
+class SaPowerModel(PowerModel):
+    pm = [
+        SaPowerOn(), # ON
+        SaPowerOff(), # CLK_GATED
+        SaPowerOff(), # SRAM_RETENTION
+        SaPowerOff(), # OFF
+    ]
+
 def cmd_line_template():
     if options.command_line and options.command_line_file:
         print("Error: --command-line and --command-line-file are "
@@ -222,6 +240,16 @@ def build_test_system(np):
             if buildEnv['TARGET_ISA'] in "arm":
                 test_sys.realview.smm.cpus = test_sys.cpu
 
+        if buildEnv['TARGET_ISA'] in "arm" and options.sa_power:
+            # A power model belongs to a subsystem, which the platform
+            # does not have: the SAs get their own
+            test_sys.sa_subsystem = SubSystem()
+            test_sys.realview.smm.default_p_state = "ON"
+            test_sys.realview.smm.power_model = SaPowerModel(
+                subsystem=test_sys.sa_subsystem)
+        if buildEnv['TARGET_ISA'] in "arm" and options.sa_timeline:
+            test_sys.realview.smm.timeline = options.sa_timeline
+
         # If elastic tracing is enabled when not restoring from checkpoint and
         # when not fast forwarding using the atomic cpu, then check that the
         # TestCPUClass is DerivO3CPU or inherits from DerivO3CPU. If the check
@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2020 EPFL
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "base/stats/csv.hh"
+
+#include <fnmatch.h>
+
+#include <cmath>
+#include <map>
+
+#include "base/cprintf.hh"
+#include "base/logging.hh"
+#include "base/stats/info.hh"
+#include "base/str.hh"
+#include "sim/core.hh"
+
+namespace Stats {
+
+namespace {
+
+// Open regions, innermost last, and the ids of the regions of the index
+std::vector<std::string> regions;
+std::map<std::string, int> regionIds;
+
+} // anonymous namespace
+
+void
+beginRegion(const std::string &name)
+{
+    regions.push_back(name);
+}
+
+void
+endRegion()
+{
+    if (!regions.empty())
+        regions.pop_back();
+}
+
+Csv::Csv(const std::string &filename, const std::string &filter)
+    : file(simout.create(filename)),
+      index(simout.create(filename + ".regions")),
+      header(true), column(0), dumps(0)
+{
+    tokenize(patterns, filter.empty() ? "*" : filter, ',');
+    if (!valid())
+        fatal("Unable to open statistics file for writing\n");
+    *index->stream() << "region,path" << std::endl;
+}
+
+bool
+Csv::valid() const
+{
+    return file && file->stream()->good();
+}
+
+bool
+Csv::selected(const Info &info) const
+{
+    if (!info.flags.isSet(display))
+        return false;
+    for (const auto &pattern : patterns) {
+        if (fnmatch(pattern.c_str(), info.name.c_str(), 0) == 0)
+            return true;
+    }
+    return false;
+}
+
+void
+Csv::add(const std::string &name, Result value)
+{
+    if (header) {
+        columns.push_back(name);
+        values.push_back(value);
+    } else if (column < values.size()) {
+        values[column] = value;
+    }
+    column++;
+}
+
+void
+Csv::begin()
+{
+    column = 0;
+}
+
+void
+Csv::end()
+{
+    std::ostream &os = *file->stream();
+    if (header) {
+        os << "dump,tick,region";
+        for (const auto &name : columns)
+            os << "," << name;
+        os << std::endl;
+        header = false;
+    } else if (column != values.size()) {
+        warn_once("The statistics of %s changed after the first dump\n",
+                  file->name());
+    }
+
+    // Outside the regions of interest, the region is 0
+    int region = 0;
+    if (!regions.empty()) {
+        auto it = regionIds.find(regions.back());
+        if (it == regionIds.end()) {
+            it = regionIds.emplace(regions.back(), regionIds.size() + 1).first;
+            *index->stream() << it->second << "," << it->first << std::endl;
+        }
+        region = it->second;
+    }
+
+    os << dumps++ << "," << curTick() << "," << region;
+    for (Result value : values) {
+        os << ",";
+        if (!std::isnan(value) && !std::isinf(value))
+            ccprintf(os, "%.12g", value);
+    }
+    os << std::endl;
+}
+
+void
+Csv::visit(const ScalarInfo &info)
+{
+    if (selected(info))
+        add(info.name, info.result());
+}
+
+void
+Csv::visit(const VectorInfo &info)
+{
+    if (!selected(info))
+        return;
+    const VResult &result = info.result();
+    for (size_t i = 0; i < info.size(); i++) {
+        bool named = i < info.subnames.size() && !info.subnames[i].empty();
+        add(info.name + "::" + (named ? info.subnames[i] : std::to_string(i)),
+            result[i]);
+    }
+    if (info.flags.isSet(total) && info.size() > 1)
+        add(info.name + "::total", info.total());
+}
+
+void
+Csv::visit(const DistInfo &info)
+{
+    // The buckets would make the rows long: only the samples and the mean
+    if (!selected(info))
+        return;
+    const DistData &data = info.data;
+    add(info.name + "::samples", data.samples);
+    add(info.name + "::mean", data.samples ? data.sum / data.samples : NAN);
+}
+
+void
+Csv::visit(const VectorDistInfo &info)
+{
+    if (!selected(info))
+        return;
+    for (size_t i = 0; i < info.size(); i++) {
+        bool named = i < info.subnames.size() && !info.subnames[i].empty();
+        std::string name = info.name + "::" +
+            (named ? info.subnames[i] : std::to_string(i));
+        const DistData &data = info.data[i];
+        add(name + "::samples", data.samples);
+        add(name + "::mean", data.samples ? data.sum / data.samples : NAN);
+    }
+}
+
+void
+Csv::visit(const Vector2dInfo &info)
+{
+    if (!selected(info))
+        return;
+    for (size_t x = 0; x < info.x; x++) {
+        bool named = x < info.subnames.size() && !info.subnames[x].empty();
+        std::string name = info.name + "::" +
+            (named ? info.subnames[x] : std::to_string(x));
+        for (size_t y = 0; y < info.y; y++) {
+            bool y_named = y < info.y_subnames.size() &&
+                !info.y_subnames[y].empty();
+            add(name + "::" + (y_named ? info.y_subnames[y] :
+                               std::to_string(y)),
+                info.cvec[x * info.y + y]);
+        }
+    }
+}
+
+void
+Csv::visit(const FormulaInfo &info)
+{
+    visit((const VectorInfo &)info);
+}
+
+void
+Csv::visit(const SparseHistInfo &info)
+{
+    // The buckets of a sparse histogram change from dump to dump
+    if (!selected(info))
+        return;
+    add(info.name + "::samples", info.data.samples);
+}
+
+Output *
+initCsv(const std::string &filename, const std::string &filter)
+{
+    static Csv *csv = nullptr;
+    if (!csv)
+        csv = new Csv(filename, filter);
+    return csv;
+}
+
+} // namespace Stats
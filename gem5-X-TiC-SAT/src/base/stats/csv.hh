@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2020 EPFL
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __BASE_STATS_CSV_HH__
+#define __BASE_STATS_CSV_HH__
+
+#include <string>
+#include <vector>
+
+#include "base/output.hh"
+#include "base/stats/output.hh"
+#include "base/stats/types.hh"
+
+namespace Stats {
+
+/**
+ * Columnar statistics: a row per dump, with the dump number, the tick and
+ * the region of interest of the dump, and a column per statistic matching
+ * one of the patterns of the filter (shell wildcards, comma separated, e.g.
+ * "*.smm.*,*.dcache.*miss*,*.numCycles"). The columns are fixed at the
+ * first dump. The regions are given by the application (m5_trace_region);
+ * their names are in an index next to the file (<file>.regions).
+ */
+class Csv : public Output
+{
+  protected:
+    OutputStream *file;
+    OutputStream *index;
+    std::vector<std::string> patterns;
+
+    // Columns of the first dump, then the values of the current one
+    bool header;
+    std::vector<std::string> columns;
+    std::vector<Result> values;
+    size_t column;
+    uint64_t dumps;
+
+    bool selected(const Info &info) const;
+    void add(const std::string &name, Result value);
+
+  public:
+    Csv(const std::string &filename, const std::string &filter);
+
+    // Implement Visit
+    void visit(const ScalarInfo &info) override;
+    void visit(const VectorInfo &info) override;
+    void visit(const DistInfo &info) override;
+    void visit(const VectorDistInfo &info) override;
+    void visit(const Vector2dInfo &info) override;
+    void visit(const FormulaInfo &info) override;
+    void visit(const SparseHistInfo &info) override;
+
+    // Implement Output
+    bool valid() const override;
+    void begin() override;
+    void end() override;
+};
+
+Output *initCsv(const std::string &filename, const std::string &filter);
+
+/**
+ * Region of interest of the application, recorded with every dump. The
+ * names are the paths of the regions (e.g. "layer0/attention").
+ */
+void beginRegion(const std::string &name);
+void endRegion();
+
+} // namespace Stats
+
+#endif // __BASE_STATS_CSV_HH__
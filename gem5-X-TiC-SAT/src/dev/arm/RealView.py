@@ -108,6 +108,25 @@ class SystolicMatrixMultiplication(BasicPioDevice):
     pio_addr = Param.Addr(0x10020000, "Address for SMM core access.")
     pio_size = Param.Int32(0x1000, "Size of SA memory-mapped address range.")
     cpus = VectorParam.BaseCPU("CPUs/harts attached to this device.")
+    # Energy per event of the SA of a core (pJ), for its energy and power
+    # statistics. The defaults are rough figures of an 8-bit 16x16 SA; set
+    # them from the synthesis of the SA to compare the builds.
+    mac_energy = Param.Float(0.25, "Energy of a MAC with non-zero operands")
+    zero_mac_energy = Param.Float(0.05,
+        "Energy of a MAC with a zero operand")
+    shift_energy = Param.Float(0.01,
+        "Energy of a byte shifted in the registers of the SA")
+    weight_write_energy = Param.Float(0.2,
+        "Energy of a word of weights written to the SA")
+    idle_energy = Param.Float(2.0,
+        "Energy of the SA in a cycle without SA instruction (leakage and "
+        "clock tree)")
+    # Timeline of the tiles (Chrome trace format, chrome://tracing or
+    # Perfetto), with the regions of interest of the application
+    timeline = Param.String("", "File of the timeline of the tiles, in the "
+        "output directory (empty: none)")
+    timeline_gap = Param.Cycles(100, "Longest gap between two instructions "
+        "of a span of the timeline")
 
 class FlagSparseMemory(BasicPioDevice):
     type = 'FlagSparseMemory'
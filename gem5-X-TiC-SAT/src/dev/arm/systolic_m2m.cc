@@ -30,10 +30,25 @@
 
 #include "dev/arm/systolic_m2m.hh"
 
+#include <algorithm>
+
+#include "base/callback.hh"
+#include "sim/core.hh"
+#include "sim/stats.hh"
+
+static const char * const tileStateNames[] = {"load", "stream", "drain"};
+
 // Constructor.
 SystolicMatrixMultiplication::SystolicMatrixMultiplication(const SystolicMatrixMultiplicationParams * p) :
 	BasicPioDevice(p, p->pio_size),
-	system(dynamic_cast<ArmSystem *>(p->system))
+	system(dynamic_cast<ArmSystem *>(p->system)),
+	energyMac(p->mac_energy),
+	energyZeroMac(p->zero_mac_energy),
+	energyShift(p->shift_energy),
+	energyWeightWrite(p->weight_write_energy),
+	energyIdle(p->idle_energy),
+	timeline(nullptr),
+	timelineGap(p->timeline_gap)
 {
 	warn("SMM core instantiated.");
     
@@ -45,6 +60,24 @@ SystolicMatrixMultiplication::SystolicMatrixMultiplication(const SystolicMatrixM
         tiles.push_back(new SATile());
     }
 
+    if (!p->timeline.empty()) {
+        spans.resize(tiles.size());
+        spanOpen.resize(tiles.size(), false);
+        timeline = simout.create(p->timeline);
+        std::ostream &os = *timeline->stream();
+        os << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [" << std::endl;
+        os << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, "
+            "\"tid\": " << tiles.size()
+           << ", \"args\": {\"name\": \"regions\"}}";
+        for (int i = 0; i < tiles.size(); i++) {
+            timelineEvent(csprintf("{\"name\": \"thread_name\", \"ph\": "
+                "\"M\", \"pid\": 0, \"tid\": %d, \"args\": {\"name\": "
+                "\"SA core %d\"}}", i, i));
+        }
+        registerExitCallback(new MakeCallback<SystolicMatrixMultiplication,
+                             &SystolicMatrixMultiplication::closeTimeline>(
+                                 this));
+    }
 }
 
 // Destructor
@@ -64,6 +97,126 @@ SystolicMatrixMultiplication::init()
 	system->setSystolicMatrixMultiplication(this);
 }
 
+void
+SystolicMatrixMultiplication::regStats()
+{
+    BasicPioDevice::regStats();
+
+    using namespace Stats;
+
+    // The platforms built without fs.py do not give the CPUs of the SA,
+    // but the vectors need at least one element
+    int tile_num = std::max(1, (int)tiles.size());
+    paramWrites
+        .init(tile_num)
+        .name(name() + ".paramWrites")
+        .desc("words of weights written to the SA of each core")
+        .flags(total | nozero)
+        ;
+    queues
+        .init(tile_num)
+        .name(name() + ".queues")
+        .desc("words of inputs queued in the SA of each core")
+        .flags(total | nozero)
+        ;
+    streams
+        .init(tile_num)
+        .name(name() + ".streams")
+        .desc("beats of the SA of each core")
+        .flags(total | nozero)
+        ;
+    macs
+        .init(tile_num)
+        .name(name() + ".macs")
+        .desc("multiply-accumulates of the PEs of each core")
+        .flags(total | nozero)
+        ;
+    activeMacs
+        .init(tile_num)
+        .name(name() + ".activeMacs")
+        .desc("multiply-accumulates with non-zero operands")
+        .flags(total | nozero)
+        ;
+    shifts
+        .init(tile_num)
+        .name(name() + ".shifts")
+        .desc("bytes shifted in the registers of the SA of each core")
+        .flags(total | nozero)
+        ;
+    for (int i = 0; i < tile_num; i++) {
+        std::string core = "core" + std::to_string(i);
+        paramWrites.subname(i, core);
+        queues.subname(i, core);
+        streams.subname(i, core);
+        macs.subname(i, core);
+        activeMacs.subname(i, core);
+        shifts.subname(i, core);
+    }
+
+    busyCycles
+        .name(name() + ".busyCycles")
+        .desc("cycles of the SA instructions of each core")
+        .flags(total)
+        ;
+    busyCycles = paramWrites + queues + streams;
+
+    idleCycles
+        .name(name() + ".idleCycles")
+        .desc("cycles without SA instructions of each core")
+        .flags(total)
+        ;
+    idleCycles = simTicks / constant(clockPeriod()) - busyCycles;
+
+    dynamicEnergy
+        .name(name() + ".dynamicEnergy")
+        .desc("energy of the activity of the SA of each core (pJ)")
+        .flags(total)
+        ;
+    dynamicEnergy = constant(energyMac) * activeMacs +
+        constant(energyZeroMac) * (macs - activeMacs) +
+        constant(energyShift) * shifts +
+        constant(energyWeightWrite) * paramWrites;
+
+    idleEnergy
+        .name(name() + ".idleEnergy")
+        .desc("energy of the idle cycles of the SA of each core (pJ)")
+        .flags(total)
+        ;
+    idleEnergy = constant(energyIdle) * idleCycles;
+
+    energy
+        .name(name() + ".energy")
+        .desc("energy of the SAs (pJ)")
+        ;
+    energy = sum(dynamicEnergy) + sum(idleEnergy);
+
+    dynamicPower
+        .name(name() + ".dynamicPower")
+        .desc("average power of the activity of the SAs (W)")
+        ;
+    dynamicPower = sum(dynamicEnergy) * constant(1e-12) / simSeconds;
+
+    idlePower
+        .name(name() + ".idlePower")
+        .desc("average power of the idle SAs (W)")
+        ;
+    idlePower = sum(idleEnergy) * constant(1e-12) / simSeconds;
+
+    avgPower
+        .name(name() + ".avgPower")
+        .desc("average power of the SAs (W)")
+        ;
+    avgPower = energy * constant(1e-12) / simSeconds;
+
+    for (int i = 0; i < tile_num; i++) {
+        std::string core = "core" + std::to_string(i);
+        busyCycles.subname(i, core);
+        idleCycles.subname(i, core);
+        dynamicEnergy.subname(i, core);
+        idleEnergy.subname(i, core);
+    }
+}
+
 bool SystolicMatrixMultiplication::loadWeights(int tid, int idx, uint32_t val) {
 
     //int idx= row * KERNEL_DIM + col * W_DATA;
@@ -71,6 +224,9 @@ bool SystolicMatrixMultiplication::loadWeights(int tid, int idx, uint32_t val) {
         auto currVal = (int8_t)((val >> (8 * (W_DATA -i-1))) & 0xff);
         tiles[tid]->weights[idx + i] = currVal;
     }
+    paramWrites[tid]++;
+    if (timeline)
+        advance(tid, SA_TILE_LOAD);
 
     if (val!=0)
         tiles[tid]->non_zero_tile = true;
@@ -84,6 +240,15 @@ uint32_t SystolicMatrixMultiplication::inputQueue(int tid, int col, uint32_t val
         int row_index = (col*W_DATA+i);
         mem2d(tiles[tid]->inWaitingMemory, KERNEL_DIM, row_index, KERNEL_DIM - row_index - 1) = currVal; // off-diagonal of the waiting memory
     }
+    queues[tid]++;
+    shifts[tid] += W_DATA;
+    if (timeline) {
+        // The row is an input if one of its words is not zero
+        tiles[tid]->non_zero_row |= val != 0;
+        bool streaming = spanOpen[tid] && spans[tid].state != SA_TILE_LOAD;
+        advance(tid, (tiles[tid]->non_zero_row || !streaming) ?
+                SA_TILE_STREAM : spans[tid].state);
+    }
 
     // Return the output
     uint32_t result = 0;
@@ -128,9 +293,21 @@ uint32_t SystolicMatrixMultiplication::streamInOut(int tid, uint32_t val) {
     }
 
     // Multiply the input to the weight and accumulate to the output
+    int active = 0;
     for (int i= KERNEL_DIM * KERNEL_DIM - 1; i >= 0 ; i--){
         tiles[tid]->outputMemory[i + KERNEL_DIM] = int(tiles[tid]->inputMemory[i] * tiles[tid]->weights[i]) + tiles[tid]->outputMemory[i];
+        active += tiles[tid]->inputMemory[i] != 0 && tiles[tid]->weights[i] != 0;
+    }
+    streams[tid]++;
+    if (timeline) {
+        advance(tid, (tiles[tid]->non_zero_row || val != 0) ?
+                SA_TILE_STREAM : SA_TILE_DRAIN);
+        tiles[tid]->non_zero_row = false;
     }
+    macs[tid] += KERNEL_DIM * KERNEL_DIM;
+    activeMacs[tid] += active;
+    // The waiting input, the inputs of the PEs and the waiting output are shifted by one column or row every beat
+    shifts[tid] += W_DATA + 3 * KERNEL_DIM * (KERNEL_DIM - 1);
 
     // Shift the input memory to the right
     for (int i = 0; i < KERNEL_DIM; i++) {
@@ -159,6 +336,70 @@ uint32_t SystolicMatrixMultiplication::streamInOut(int tid, uint32_t val) {
 
 }
 
+void
+SystolicMatrixMultiplication::timelineEvent(const std::string &event)
+{
+    *timeline->stream() << "," << std::endl << event;
+}
+
+void
+SystolicMatrixMultiplication::advance(int tid, SATileState state)
+{
+    Tick now = curTick();
+    SATimelineSpan &span = spans[tid];
+    if (spanOpen[tid] && span.state == state &&
+        now - span.end <= cyclesToTicks(timelineGap)) {
+        span.end = now;
+        return;
+    }
+    if (spanOpen[tid])
+        writeSpan(tid);
+    span = {state, now, now};
+    spanOpen[tid] = true;
+}
+
+void
+SystolicMatrixMultiplication::writeSpan(int tid)
+{
+    // Each instruction takes a cycle of the SA
+    const SATimelineSpan &span = spans[tid];
+    double us = (double)SimClock::Int::us;
+    timelineEvent(csprintf("{\"name\": \"%s\", \"cat\": \"sa\", \"ph\": "
+        "\"X\", \"pid\": 0, \"tid\": %d, \"ts\": %f, \"dur\": %f}",
+        tileStateNames[span.state], tid, span.start / us,
+        (span.end + clockPeriod() - span.start) / us));
+    spanOpen[tid] = false;
+}
+
+void
+SystolicMatrixMultiplication::traceRegion(const std::string &name)
+{
+    if (!timeline)
+        return;
+    double ts = curTick() / (double)SimClock::Int::us;
+    if (name.empty()) {
+        timelineEvent(csprintf("{\"cat\": \"roi\", \"ph\": \"E\", "
+            "\"pid\": 0, \"tid\": %d, \"ts\": %f}", tiles.size(), ts));
+        return;
+    }
+    std::string leaf = name.substr(name.rfind('/') + 1);
+    timelineEvent(csprintf("{\"name\": \"%s\", \"cat\": \"roi\", \"ph\": "
+        "\"B\", \"pid\": 0, \"tid\": %d, \"ts\": %f, \"args\": "
+        "{\"path\": \"%s\"}}", leaf, tiles.size(), ts, name));
+}
+
+void
+SystolicMatrixMultiplication::closeTimeline()
+{
+    for (int tid = 0; tid < tiles.size(); tid++) {
+        if (spanOpen[tid])
+            writeSpan(tid);
+    }
+    *timeline->stream() << std::endl << "]}" << std::endl;
+    simout.close(timeline);
+    timeline = nullptr;
+}
+
 // Read to ACM based on packet interation.
 Tick
 SystolicMatrixMultiplication::read(PacketPtr pkt)
@@ -32,6 +32,8 @@
 #define __SYSTOLIC_M2M_H__
 
 #include "arch/arm/system.hh"
+#include "base/output.hh"
+#include "base/statistics.hh"
 #include "dev/io_device.hh"
 #include "debug/SMM.hh"
 #include "mem/packet.hh"
@@ -49,6 +51,19 @@
 class ArmSystem;
 class BaseCPU;
 
+// States of a tile in the timeline, as in accelerator/sa_trace.h
+enum SATileState {
+    SA_TILE_LOAD,    // weights written
+    SA_TILE_STREAM,  // rows of inputs streamed
+    SA_TILE_DRAIN,   // zero rows streamed to get the last outputs
+};
+
+struct SATimelineSpan {
+    SATileState state;
+    Tick start;
+    Tick end;
+};
+
 struct SATile {
     SATile():
     weights(new int8_t[KERNEL_DIM * KERNEL_DIM]),
@@ -76,6 +91,7 @@ struct SATile {
     int8_t * inWaitingMemory;
     uint8_t * outWaitingMemory;
     bool non_zero_tile = false;
+    bool non_zero_row = false;   // words of the next row queued, timeline
 };
 
 class SystolicMatrixMultiplication : public BasicPioDevice {
@@ -87,9 +103,44 @@ class SystolicMatrixMultiplication : public BasicPioDevice {
       
     // System this ACM belongs to.
     ArmSystem * system;
-    
-    
-    
+
+    // Energy of each event of a tile (pJ), see the parameters of
+    // SystolicMatrixMultiplication in RealView.py
+    const double energyMac;
+    const double energyZeroMac;
+    const double energyShift;
+    const double energyWeightWrite;
+    const double energyIdle;
+
+    // Activity of the tile of each core, for the energy model
+    Stats::Vector paramWrites;
+    Stats::Vector queues;
+    Stats::Vector streams;
+    Stats::Vector macs;          // multiply-accumulates of the PEs
+    Stats::Vector activeMacs;    // ... with non-zero operands
+    Stats::Vector shifts;        // bytes moved in the registers of the SA
+    Stats::Formula busyCycles;   // one cycle per SA instruction
+    Stats::Formula idleCycles;
+    Stats::Formula dynamicEnergy;
+    Stats::Formula idleEnergy;
+    Stats::Formula energy;
+    Stats::Formula dynamicPower;
+    Stats::Formula idlePower;
+    Stats::Formula avgPower;
+
+    // Chrome trace of the states of the tiles (nullptr: none). The spans
+    // are written when they end, the regions of interest (m5_trace_region)
+    // on a track of their own.
+    OutputStream * timeline;
+    const Cycles timelineGap;    // longest gap between the beats of a span
+    std::vector<SATimelineSpan> spans;
+    std::vector<bool> spanOpen;
+
+    void timelineEvent(const std::string &event);
+    void advance(int tid, SATileState state);
+    void writeSpan(int tid);
+    void closeTimeline();
+
   public:
       typedef SystolicMatrixMultiplicationParams Params;
       const Params * params() const {
@@ -98,12 +149,15 @@ class SystolicMatrixMultiplication : public BasicPioDevice {
     SystolicMatrixMultiplication(const Params * p);
     ~SystolicMatrixMultiplication();
     void init() override;
+    void regStats() override;
     
     bool loadWeights(int tid, int idx, uint32_t  val);
     uint32_t inputQueue(int tid, int col, uint32_t  val);
     void printWeights();
     uint32_t readFlag(int tid, uint32_t val);
     uint32_t streamInOut(int tid, uint32_t val);
+    // Begins a region of interest of the timeline, or ends it (name empty)
+    void traceRegion(const std::string &name);
     
 
     // Required by SimObject.
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2020 EPFL
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "mem/probes/tensor_traffic.hh"
+
+#include "base/logging.hh"
+#include "params/TensorTrafficProbe.hh"
+#include "sim/tensor_map.hh"
+
+TensorTrafficProbe::TensorTrafficProbe(TensorTrafficProbeParams *p)
+    : BaseMemProbe(p),
+      maxTensors(p->max_tensors),
+      named(p->max_tensors, false)
+{
+    fatal_if(maxTensors < 3,
+             "TensorTrafficProbe needs at least 3 bins.");
+}
+
+void
+TensorTrafficProbe::regStats()
+{
+    BaseMemProbe::regStats();
+
+    using namespace Stats;
+
+    reads
+        .init(maxTensors)
+        .name(name() + ".reads")
+        .desc("read requests of each tensor")
+        .flags(total | nozero)
+        ;
+    writes
+        .init(maxTensors)
+        .name(name() + ".writes")
+        .desc("write requests (and writebacks) of each tensor")
+        .flags(total | nozero)
+        ;
+    readBytes
+        .init(maxTensors)
+        .name(name() + ".readBytes")
+        .desc("bytes read from each tensor")
+        .flags(total | nozero)
+        ;
+    writeBytes
+        .init(maxTensors)
+        .name(name() + ".writeBytes")
+        .desc("bytes written to each tensor")
+        .flags(total | nozero)
+        ;
+    bytes
+        .name(name() + ".bytes")
+        .desc("bytes read from and written to each tensor")
+        .flags(total | nozero)
+        ;
+    bytes = readBytes + writeBytes;
+
+    // The tensors are registered by the application during the
+    // simulation: their bins are named when they are first accessed
+    reads.subname(0, "untagged");
+    writes.subname(0, "untagged");
+    readBytes.subname(0, "untagged");
+    writeBytes.subname(0, "untagged");
+    bytes.subname(0, "untagged");
+    named[0] = true;
+}
+
+void
+TensorTrafficProbe::handleRequest(const ProbePoints::PacketInfo &pi)
+{
+    if (!pi.cmd.isRead() && !pi.cmd.isWrite())
+        return;
+
+    int bin = TensorMap::get().lookup(pi.addr);
+    if (bin >= maxTensors - 1) {
+        warn_once("%s: more than %d tensors, the others share a bin\n",
+                  name(), maxTensors - 2);
+        bin = maxTensors - 1;
+    }
+    if (!named[bin]) {
+        std::string tensor = bin == maxTensors - 1 ? "others" :
+            TensorMap::get().name(bin);
+        reads.subname(bin, tensor);
+        writes.subname(bin, tensor);
+        readBytes.subname(bin, tensor);
+        writeBytes.subname(bin, tensor);
+        bytes.subname(bin, tensor);
+        named[bin] = true;
+    }
+
+    if (pi.cmd.isRead()) {
+        reads[bin]++;
+        readBytes[bin] += pi.size;
+    } else {
+        writes[bin]++;
+        writeBytes[bin] += pi.size;
+    }
+}
+
+TensorTrafficProbe *
+TensorTrafficProbeParams::create()
+{
+    return new TensorTrafficProbe(this);
+}
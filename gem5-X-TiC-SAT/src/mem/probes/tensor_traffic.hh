@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2020 EPFL
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __MEM_PROBES_TENSOR_TRAFFIC_HH__
+#define __MEM_PROBES_TENSOR_TRAFFIC_HH__
+
+#include <vector>
+
+#include "mem/probes/base.hh"
+#include "sim/stats.hh"
+
+struct TensorTrafficProbeParams;
+
+/**
+ * Probe binning the requests it sees per tensor of the simulated
+ * application (see TensorMap and m5_tensor_register). On a CommMonitor
+ * between the L1 caches and the L2 cache, the requests are the misses
+ * of the L1 caches; between the L2 cache and the memory bus, they are
+ * the misses and the writebacks of the L2 cache.
+ */
+class TensorTrafficProbe : public BaseMemProbe
+{
+  public:
+    TensorTrafficProbe(TensorTrafficProbeParams *p);
+    void regStats() override;
+
+  protected:
+    void handleRequest(const ProbePoints::PacketInfo &pkt_info) override;
+
+    /** Bins of the tensors, the last one shared by the extra tensors */
+    const int maxTensors;
+    /** Bins whose tensor name is set */
+    std::vector<bool> named;
+
+    Stats::Vector reads;
+    Stats::Vector writes;
+    Stats::Vector readBytes;
+    Stats::Vector writeBytes;
+    Stats::Formula bytes;
+};
+
+#endif // __MEM_PROBES_TENSOR_TRAFFIC_HH__
@@ -105,6 +105,12 @@ def parse_options():
     group("Statistics Options")
     option("--stats-file", metavar="FILE", default="stats.txt",
         help="Sets the output file for statistics [Default: %default]")
+    option("--stats-csv", metavar="FILE", default="",
+        help="Also writes the statistics matching --stats-csv-filter to FILE, "
+             "a row per dump (see m5.stats)")
+    option("--stats-csv-filter", metavar="PATTERNS", default="",
+        help="Comma-separated wildcards of the statistics of --stats-csv "
+             "[Default: all]")
 
     # Configuration Options
     group("Configuration Options")
@@ -343,6 +349,9 @@ def main(*args):
 
     # set stats options
     stats.addStatVisitor(options.stats_file)
+    if options.stats_csv:
+        stats.addStatVisitor("csv://%s?filter=%r" % (options.stats_csv,
+                                                     options.stats_csv_filter))
 
     # Disable listeners unless running interactively or explicitly
     # enabled
@@ -115,11 +115,28 @@ def _textFactory(fn, desc=True):
 
     return _m5.stats.initText(fn, desc)
 
+@_url_factory
+def _csvFactory(fn, filter=""):
+    """Output selected stats in CSV format.
+
+    CSV stat files contain one row per dump, with the dump number, the
+    tick and the region of interest of the application (m5_trace_region,
+    named in the <file>.regions index), and one column per stat whose
+    name matches one of the comma-separated shell wildcards of the filter
+    parameter (all the stats by default).
+
+    Example: csv://stats.csv?filter='*.smm.*,*.dcache.*miss*'
+
+    """
+
+    return _m5.stats.initCsv(fn, filter)
+
 factories = {
     # Default to the text factory if we're given a naked path
     "" : _textFactory,
     "file" : _textFactory,
     "text" : _textFactory,
+    "csv" : _csvFactory,
 }
 
 def addStatVisitor(url):
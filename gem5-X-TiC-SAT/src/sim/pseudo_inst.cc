@@ -46,6 +46,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cerrno>
 #include <fstream>
 #include <string>
@@ -58,7 +59,9 @@
 #include "arch/utility.hh"
 #include "arch/vtophys.hh"
 #include "base/debug.hh"
+#include "base/intmath.hh"
 #include "base/output.hh"
+#include "base/stats/csv.hh"
 #include "config/the_isa.hh"
 #include "cpu/base.hh"
 #include "cpu/quiesce_event.hh"
@@ -68,6 +71,7 @@
 #include "debug/Quiesce.hh"
 #include "debug/WorkItems.hh"
 #include "dev/net/dist_iface.hh"
+#include "mem/page_table.hh"
 #include "params/BaseCPU.hh"
 #include "sim/full_system.hh"
 #include "sim/initparam_keys.hh"
@@ -78,8 +82,14 @@
 #include "sim/stat_control.hh"
 #include "sim/stats.hh"
 #include "sim/system.hh"
+#include "sim/tensor_map.hh"
 #include "sim/vptr.hh"
 
+#if THE_ISA == ARM_ISA
+#include "arch/arm/system.hh"
+#include "dev/arm/systolic_m2m.hh"
+#endif
+
 using namespace std;
 
 using namespace Stats;
@@ -197,9 +207,15 @@ pseudoInst(ThreadContext *tc, uint8_t func, uint8_t subfunc)
         workend(tc, args[0], args[1]);
         break;
 
+      case M5OP_TENSOR_REGISTER:
+        tensorRegister(tc, args[0], args[1], args[2]);
+        break;
+
+      case M5OP_TRACE_REGION:
+        traceRegion(tc, args[0]);
+        break;
+
       case M5OP_ANNOTATE:
-      case M5OP_RESERVED2:
-      case M5OP_RESERVED3:
       case M5OP_RESERVED4:
       case M5OP_RESERVED5:
         warn("Unimplemented m5 op (0x%x)\n", func);
@@ -387,6 +403,66 @@ addsymbol(ThreadContext *tc, Addr addr, Addr symbolAddr)
     debugSymbolTable->insert(addr,symbol);
 }
 
+void
+tensorRegister(ThreadContext *tc, Addr addr, uint64_t size, Addr nameAddr)
+{
+    DPRINTF(PseudoInst, "PseudoInst::tensorRegister(0x%x, %d, 0x%x)\n",
+            addr, size, nameAddr);
+
+    char tensor_name[100];
+    CopyStringOut(tc, tensor_name, nameAddr, 100);
+    TensorMap &tensors = TensorMap::get();
+    int id = tensors.id(tensor_name);
+
+    // The pages of the tensor are not contiguous in physical memory: each
+    // one is translated now, so the tensor must be mapped (touched) before
+    Addr end = addr + size;
+    for (Addr vaddr = addr; vaddr < end; ) {
+        Addr page_end = roundDown(vaddr, TheISA::PageBytes) +
+            TheISA::PageBytes;
+        Addr len = std::min(page_end, end) - vaddr;
+        Addr paddr = 0;
+        bool mapped;
+        if (FullSystem) {
+#if THE_ISA == ARM_ISA
+            mapped = TheISA::virtvalid(tc, vaddr);
+#else
+            mapped = true;
+#endif
+            if (mapped)
+                paddr = TheISA::vtophys(tc, vaddr);
+        } else {
+            mapped = tc->getProcessPtr()->pTable->translate(vaddr, paddr);
+        }
+        if (mapped)
+            tensors.insert(paddr, len, id);
+        else
+            DPRINTF(PseudoInst, "Tensor %s: page 0x%x not mapped\n",
+                    tensor_name, vaddr);
+        vaddr += len;
+    }
+}
+
+void
+traceRegion(ThreadContext *tc, Addr nameAddr)
+{
+    DPRINTF(PseudoInst, "PseudoInst::traceRegion(0x%x)\n", nameAddr);
+
+    // A null name ends the innermost region
+    char name[256] = "";
+    if (nameAddr) {
+        CopyStringOut(tc, name, nameAddr, sizeof(name));
+        Stats::beginRegion(name);
+    } else {
+        Stats::endRegion();
+    }
+#if THE_ISA == ARM_ISA
+    ArmSystem *system = ArmSystem::getArmSystem();
+    if (system && system->getSystolicMatrixMultiplication())
+        system->getSystolicMatrixMultiplication()->traceRegion(name);
+#endif
+}
+
 uint64_t
 initParam(ThreadContext *tc, uint64_t key_str1, uint64_t key_str2)
 {
@@ -75,6 +75,9 @@ uint64_t writefile(ThreadContext *tc, Addr vaddr, uint64_t len,
     uint64_t offset, Addr filenameAddr);
 void loadsymbol(ThreadContext *xc);
 void addsymbol(ThreadContext *tc, Addr addr, Addr symbolAddr);
+void tensorRegister(ThreadContext *tc, Addr addr, uint64_t size,
+                    Addr nameAddr);
+void traceRegion(ThreadContext *tc, Addr nameAddr);
 uint64_t initParam(ThreadContext *xc, uint64_t key_str1, uint64_t key_str2);
 uint64_t rpns(ThreadContext *tc);
 void wakeCPU(ThreadContext *tc, uint64_t cpuid);
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2020 EPFL
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "sim/tensor_map.hh"
+
+#include <algorithm>
+#include <iterator>
+
+TensorMap &
+TensorMap::get()
+{
+    static TensorMap map;
+    return map;
+}
+
+TensorMap::TensorMap()
+    : names({"untagged"})
+{
+}
+
+int
+TensorMap::id(const std::string &name)
+{
+    auto it = std::find(names.begin(), names.end(), name);
+    if (it != names.end())
+        return it - names.begin();
+    names.push_back(name);
+    return names.size() - 1;
+}
+
+void
+TensorMap::insert(Addr addr, Addr size, int id)
+{
+    if (size == 0)
+        return;
+    Addr end = addr + size;
+
+    // Cut the range that begins before addr and overlaps the new one
+    auto it = ranges.lower_bound(addr);
+    if (it != ranges.begin()) {
+        auto prev = std::prev(it);
+        if (prev->second.first > addr) {
+            std::pair<Addr, int> old = prev->second;
+            prev->second.first = addr;
+            if (old.first > end)
+                ranges[end] = old;
+        }
+    }
+
+    // Remove the ranges that begin inside the new one, keeping their end
+    it = ranges.lower_bound(addr);
+    while (it != ranges.end() && it->first < end) {
+        if (it->second.first > end)
+            ranges[end] = it->second;
+        it = ranges.erase(it);
+    }
+
+    // Merge with the previous range of the same tensor (contiguous pages)
+    it = ranges.lower_bound(addr);
+    if (it != ranges.begin()) {
+        auto prev = std::prev(it);
+        if (prev->second.first == addr && prev->second.second == id) {
+            prev->second.first = end;
+            return;
+        }
+    }
+    ranges[addr] = std::make_pair(end, id);
+}
+
+int
+TensorMap::lookup(Addr addr) const
+{
+    auto it = ranges.upper_bound(addr);
+    if (it == ranges.begin())
+        return 0;
+    --it;
+    return addr < it->second.first ? it->second.second : 0;
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2020 EPFL
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __SIM_TENSOR_MAP_HH__
+#define __SIM_TENSOR_MAP_HH__
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/types.hh"
+
+/**
+ * Named tensors of the simulated application, registered with the
+ * m5_tensor_register pseudo instruction: the physical ranges of their
+ * pages, so that memory probes can attribute the traffic to the
+ * tensors (see TensorTrafficProbe). A range registered again belongs to
+ * the last tensor. Tensor 0 stands for the memory of no tensor.
+ */
+class TensorMap
+{
+  public:
+    static TensorMap &get();
+
+    /** Id of the tensor of the given name, added if it is new */
+    int id(const std::string &name);
+    const std::string &name(int id) const { return names[id]; }
+    int size() const { return names.size(); }
+
+    /** Assigns the physical range [addr, addr + size) to a tensor */
+    void insert(Addr addr, Addr size, int id);
+    /** Tensor of a physical address, 0 if none */
+    int lookup(Addr addr) const;
+
+  private:
+    TensorMap();
+
+    std::vector<std::string> names;
+    /** Start of each range -> end of the range and tensor */
+    std::map<Addr, std::pair<Addr, int>> ranges;
+};
+
+#endif // __SIM_TENSOR_MAP_HH__
@@ -0,0 +1,323 @@
+//
+// Analytic design-space exploration of the SA accelerator: for every SA size, core count and memory arrangement,
+// the SA instructions, the fill and drain overhead, the cache footprint and the cycles of the whole encoder are
+// predicted from the tiling loops of smmComputeRWMA and smmComputeBWMA (the same split of the work across the cores,
+// the same weight tiles and passes of rows), without running the kernels. The cycle model is the one of
+// tools/saReplay.cc (a latency per SA instruction, the cores waiting for each other at the end of each GEMM), plus
+// a coarse penalty when the working set of a core does not fit in its L1 cache: a point can be checked by replaying
+// a trace of it. The points that no other point beats on both the cycles and the number of processing elements
+// (cores x SA size^2) form the Pareto front, the candidates worth a gem5 run.
+// The results are written as JSON on stdout and a table on stderr.
+// This is a host tool: build it with `make dse` or with the design_space target of CMake.
+//
+// Usage: design_space [--sa-sizes 4,8,16,32,64] [--cores 1,2,4,8,16] [--param-write N] [--queue N] [--stream N]
+//                     [--issue N] [--l1-kb N] [--l2-latency N] [--pareto-only 1] [model keys of the transformer]
+//   The model keys (--config <file>, --seq_len, --batch, --d_model, --num_heads, --kv_heads, --head_size, --ff_size,
+//   --num_layers, ...) give the shapes of the encoder, as for the transformer binary.
+//
+
+#include "../accelerator/smm_gem.h"
+#include "../transformer_layers/modelConfig.h"
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#define W_DATA 4
+#define CACHE_LINE 64
+
+struct Latencies {
+    uint64_t param_write = 1;
+    uint64_t queue = 1;
+    uint64_t stream = 1;
+    uint64_t issue = 1;
+    uint64_t l2 = 10; // cycles per cache line read from the L2 cache when the working set exceeds the L1 cache
+    uint64_t l1_bytes = 32 * 1024;
+};
+
+// A GEMM of the encoder: rows x input_size by input_size x output_size, count times
+struct Gemm {
+    std::size_t rows;
+    std::size_t input_size;
+    std::size_t output_size;
+    std::size_t count;
+};
+
+// Work of one core in a GEMM
+struct CoreWork {
+    uint64_t param_writes = 0;
+    uint64_t queues = 0;
+    uint64_t streams = 0;
+    uint64_t drain_streams = 0;
+    uint64_t bytes = 0;       // data read by the core
+    uint64_t footprint = 0;   // working set of its innermost tile loop
+};
+
+struct Point {
+    int sa_size;
+    int cores;
+    bool bwma;
+    uint64_t param_writes;
+    uint64_t queues;
+    uint64_t streams;
+    double drain;             // share of the streamed beats that only fill or drain the SA
+    uint64_t footprint;       // largest working set of a core
+    uint64_t cycles;
+    double imbalance;         // share of the core cycles spent waiting at the end of the GEMMs
+    bool pareto;
+};
+
+// Adds a pass of rows through one weight tile
+static void addPass(CoreWork &work, uint64_t tile, uint64_t rows) {
+    uint64_t max_col = tile / W_DATA;
+    work.param_writes += tile * max_col;
+    work.streams += rows + 2 * tile - 2;
+    work.drain_streams += 2 * tile - 2;
+    work.queues += max_col * (rows + 2 * tile - 1) - 1 - (rows + 2 * tile - 2);
+}
+
+// The column blocks of the weights are split in chunks across the cores (smmComputeBWMA); every weight tile is loaded
+// once for all the rows
+static std::vector<CoreWork> workBWMA(const Gemm &gemm, int tile, int cores) {
+    std::vector<CoreWork> work(cores);
+    int col_blocks = (int) (gemm.output_size / tile);
+    int col_in_th = (col_blocks + cores - 1) / cores;
+    for (int c = 0; c < cores; c++) {
+        int start = std::min(col_in_th * c, col_blocks);
+        int end = std::min(start + col_in_th, col_blocks);
+        for (int col = start; col < end; col++) {
+            for (std::size_t row = 0; row < gemm.input_size / tile; row++) {
+                addPass(work[c], tile, gemm.rows);
+            }
+        }
+        uint64_t tiles = (uint64_t) (end - start) * (gemm.input_size / tile);
+        work[c].bytes = tiles * (tile * tile + 2 * gemm.rows * tile);
+        // A weight tile, and the column blocks of the input and of the output it streams
+        work[c].footprint = end > start ? tile * tile + 2 * gemm.rows * tile : 0;
+    }
+    return work;
+}
+
+// The blocks of 128 rows of an L2 block are split in chunks across the cores (smmComputeRWMA); every weight tile is
+// loaded again for each block of rows
+static std::vector<CoreWork> workRWMA(const Gemm &gemm, int tile, int cores) {
+    std::vector<CoreWork> work(cores);
+    int seq_len = (int) gemm.rows;
+    int rows_in_block = std::min(128, seq_len);
+    int rows_in_l2 = std::min(512 / rows_in_block, (seq_len + rows_in_block - 1) / rows_in_block);
+    int l2_blocks = (seq_len + rows_in_block * rows_in_l2 - 1) / (rows_in_block * rows_in_l2);
+    int col_in_th = (rows_in_l2 + cores - 1) / cores;
+    uint64_t weight_tiles = (gemm.input_size / tile) * (gemm.output_size / tile);
+    // The L1 tile of smmComputeRWMA: rowMaxL1 x colMaxL1 weight tiles, with their input and output rows
+    int row_max_l1 = std::min(64, (int) gemm.input_size) / tile;
+    int ratio = 64 / std::min(64, (int) gemm.input_size);
+    int col_max_l1 = std::min(32 * ratio, (int) gemm.output_size) / tile;
+    uint64_t footprint = (uint64_t) row_max_l1 * col_max_l1 * tile * tile +
+                         (uint64_t) rows_in_block * (row_max_l1 + col_max_l1) * tile;
+    for (int c = 0; c < cores; c++) {
+        for (int l2 = 0; l2 < l2_blocks; l2++) {
+            for (int block = c * col_in_th; block < std::min((c + 1) * col_in_th, rows_in_l2); block++) {
+                int first_row = (l2 * rows_in_l2 + block) * rows_in_block;
+                if (first_row >= seq_len)
+                    break;
+                int rows = std::min(rows_in_block, seq_len - first_row);
+                for (uint64_t t = 0; t < weight_tiles; t++) {
+                    addPass(work[c], tile, rows);
+                }
+                work[c].bytes += weight_tiles * (tile * tile + 2 * (uint64_t) rows * tile);
+                work[c].footprint = footprint;
+            }
+        }
+    }
+    return work;
+}
+
+// The GEMMs of the encoder on the SA (see TransformerBlock and SingleHeadSelfAttn)
+static std::vector<Gemm> encoderGemms(const ModelConfig &config) {
+    std::size_t rows = config.batch * config.seq_len;
+    std::size_t kv_heads = config.kv_heads ? config.kv_heads : config.num_heads;
+    std::size_t layers = config.num_layers;
+    return {
+            {rows, config.d_model, config.head_size, layers * (config.num_heads + 2 * kv_heads)}, // q, k, v
+            {config.seq_len, config.head_size, config.seq_len, layers * config.batch * config.num_heads}, // q x k
+            {config.seq_len, config.seq_len, config.head_size, layers * config.batch * config.num_heads}, // s x v
+            {rows, config.num_heads * config.head_size, config.d_model, layers},                  // condense
+            {rows, config.d_model, config.ff_size, layers},                                        // ff0
+            {rows, config.ff_size, config.d_model, layers},                                        // ff1
+    };
+}
+
+static bool evaluate(const ModelConfig &config, int tile, int cores, bool bwma, const Latencies &latencies,
+                     Point &point) {
+    std::vector<Gemm> gemms = encoderGemms(config);
+    for (const Gemm &gemm : gemms) {
+        if (gemm.rows % tile != 0 || gemm.input_size % tile != 0 || gemm.output_size % tile != 0)
+            return false;
+        if (!bwma && !smmTilesRWMA(gemm.input_size, gemm.output_size, tile))
+            return false;
+    }
+
+    point = {tile, cores, bwma, 0, 0, 0, 0.0, 0, 0, 0.0, false};
+    uint64_t drain_streams = 0;
+    uint64_t core_cycles = 0;
+    for (const Gemm &gemm : gemms) {
+        std::vector<CoreWork> work = bwma ? workBWMA(gemm, tile, cores) : workRWMA(gemm, tile, cores);
+        uint64_t longest = 0;
+        for (const CoreWork &core : work) {
+            uint64_t cycles = core.param_writes * (latencies.issue + latencies.param_write) +
+                              core.queues * (latencies.issue + latencies.queue) +
+                              core.streams * (latencies.issue + latencies.stream);
+            if (core.footprint > latencies.l1_bytes)
+                cycles += core.bytes / CACHE_LINE * latencies.l2;
+            longest = std::max(longest, cycles);
+            core_cycles += cycles * gemm.count;
+            point.param_writes += core.param_writes * gemm.count;
+            point.queues += core.queues * gemm.count;
+            point.streams += core.streams * gemm.count;
+            drain_streams += core.drain_streams * gemm.count;
+            point.footprint = std::max(point.footprint, core.footprint);
+        }
+        point.cycles += longest * gemm.count;
+    }
+    point.drain = point.streams ? (double) drain_streams / (double) point.streams : 0.0;
+    point.imbalance = point.cycles ? 1.0 - (double) core_cycles / (double) (point.cycles * cores) : 0.0;
+    return true;
+}
+
+static uint64_t processingElements(const Point &point) {
+    return (uint64_t) point.cores * point.sa_size * point.sa_size;
+}
+
+static void markPareto(std::vector<Point> &points) {
+    for (Point &p : points) {
+        p.pareto = std::none_of(points.begin(), points.end(), [&p](const Point &q) {
+            return q.cycles <= p.cycles && processingElements(q) <= processingElements(p) &&
+                   (q.cycles < p.cycles || processingElements(q) < processingElements(p));
+        });
+    }
+}
+
+static bool parseList(const std::string &text, std::vector<int> &values) {
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        try {
+            values.push_back(std::stoi(item));
+        } catch (const std::exception &) {
+            return false;
+        }
+    }
+    return !values.empty();
+}
+
+int main(int argc, char **argv) {
+    std::vector<int> sa_sizes = {4, 8, 16, 32, 64};
+    std::vector<int> core_counts = {1, 2, 4, 8, 16};
+    Latencies latencies;
+    bool pareto_only = false;
+
+    // The options of the exploration; the others are the model keys of ModelConfig
+    std::vector<char *> model_args = {argv[0]};
+    for (int i = 1; i < argc; i++) {
+        std::string key = argv[i];
+        bool option = key == "--sa-sizes" || key == "--cores" || key == "--param-write" || key == "--queue" ||
+                      key == "--stream" || key == "--issue" || key == "--l1-kb" || key == "--l2-latency" ||
+                      key == "--pareto-only";
+        if (!option) {
+            model_args.push_back(argv[i]);
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << key << std::endl;
+            return 1;
+        }
+        std::vector<int> values;
+        if (!parseList(argv[++i], values) || (key != "--sa-sizes" && key != "--cores" && values.size() != 1) ||
+            *std::min_element(values.begin(), values.end()) < 0) {
+            std::cerr << "Invalid argument: " << key << " " << argv[i] << std::endl;
+            return 1;
+        }
+        if (key == "--sa-sizes") {
+            sa_sizes = values;
+        } else if (key == "--cores") {
+            core_counts = values;
+        } else if (key == "--param-write") {
+            latencies.param_write = values[0];
+        } else if (key == "--queue") {
+            latencies.queue = values[0];
+        } else if (key == "--stream") {
+            latencies.stream = values[0];
+        } else if (key == "--issue") {
+            latencies.issue = values[0];
+        } else if (key == "--l1-kb") {
+            latencies.l1_bytes = (uint64_t) values[0] * 1024;
+        } else if (key == "--l2-latency") {
+            latencies.l2 = values[0];
+        } else {
+            pareto_only = values[0] != 0;
+        }
+    }
+    ModelConfig config;
+    if (!config.parseArgs((int) model_args.size(), model_args.data()))
+        return 1;
+    if (config.seq_len == 0 || config.batch == 0 || config.d_model == 0 || config.num_heads == 0 ||
+        config.head_size == 0 || config.ff_size == 0 || config.num_layers == 0 ||
+        (config.kv_heads != 0 && config.num_heads % config.kv_heads != 0)) {
+        std::cerr << "Invalid model shape" << std::endl;
+        return 1;
+    }
+    for (int size : sa_sizes) {
+        if (size < 4 || size % 4 != 0 || size * size / W_DATA > (1 << 14)) {
+            std::cerr << "The SA sizes must be multiples of 4, at most 256" << std::endl;
+            return 1;
+        }
+    }
+    for (int cores : core_counts) {
+        if (cores < 1 || cores > MAX_CORE_NUM) {
+            std::cerr << "The core counts must be between 1 and " << MAX_CORE_NUM << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<Point> points;
+    for (int size : sa_sizes) {
+        for (int cores : core_counts) {
+            for (bool bwma : {false, true}) {
+                Point point{};
+                if (evaluate(config, size, cores, bwma, latencies, point))
+                    points.push_back(point);
+            }
+        }
+    }
+    markPareto(points);
+    std::sort(points.begin(), points.end(), [](const Point &a, const Point &b) { return a.cycles < b.cycles; });
+
+    std::cerr << "Encoder: " << config.num_layers << " layers, " << config.batch << " x " << config.seq_len
+              << " rows, d_model " << config.d_model << ", " << config.num_heads << " heads of " << config.head_size
+              << ", ff_size " << config.ff_size << std::endl;
+    std::cerr << std::setw(5) << "SA" << std::setw(6) << "cores" << std::setw(7) << "layout" << std::setw(10) << "PEs"
+              << std::setw(14) << "M SA ins" << std::setw(9) << "drain %" << std::setw(14) << "footprint KB"
+              << std::setw(16) << "Mcycles" << std::setw(8) << "wait %" << "  pareto" << std::endl;
+    std::cout << "[" << std::endl;
+    bool first = true;
+    for (const Point &p : points) {
+        if (pareto_only && !p.pareto)
+            continue;
+        std::cout << (first ? "" : ",\n") << "  {\"sa_size\": " << p.sa_size << ", \"cores\": " << p.cores
+                  << ", \"layout\": \"" << (p.bwma ? "bwma" : "rwma") << "\", \"processing_elements\": "
+                  << processingElements(p) << ", \"param_writes\": " << p.param_writes << ", \"queues\": "
+                  << p.queues << ", \"streams\": " << p.streams << ", \"drain\": " << p.drain
+                  << ", \"footprint_bytes\": " << p.footprint << ", \"cycles\": " << p.cycles << ", \"wait\": "
+                  << p.imbalance << ", \"pareto\": " << (p.pareto ? "true" : "false") << "}";
+        first = false;
+        std::cerr << std::setw(5) << p.sa_size << std::setw(6) << p.cores << std::setw(7)
+                  << (p.bwma ? "bwma" : "rwma") << std::setw(10) << processingElements(p) << std::fixed
+                  << std::setprecision(1) << std::setw(14)
+                  << 1e-6 * (double) (p.param_writes + p.queues + p.streams) << std::setw(9) << 100 * p.drain
+                  << std::setw(14) << (double) p.footprint / 1024 << std::setw(16) << 1e-6 * (double) p.cycles
+                  << std::setw(8) << 100 * p.imbalance << (p.pareto ? "  *" : "") << std::endl;
+    }
+    std::cout << std::endl << "]" << std::endl;
+    return 0;
+}
@@ -0,0 +1,357 @@
+//
+// Host benchmark of the kernels on the shapes of the encoder: the GEMMs (conventionalCompute, tiledCompute, the SA
+// kernels on the host model of the DEVELOP builds and, in -DSIMD builds, the NEON kernels), Softmax, AddNormalize,
+// Transpose and the memory arrangement conversions, for each core count. Every GEMM output is checked against
+// conventionalCompute, and the block-wise variants of the other layers against the row-wise ones, so a kernel can be
+// changed and checked in seconds without a gem5 run.
+// The results are written as JSON on stdout (one object per measurement, with GMAC/s for the GEMMs and bytes/s for
+// all), a readable summary on stderr. The exit status is 1 if an output does not match.
+// This is a host tool: build it with `make kernel-bench` or with the kernel_benchmark target of CMake.
+//
+// Usage: kernel_benchmark [--seq-len N] [--shapes 768x64,768x768,768x3072,3072x768] [--cores 1,2,4]
+//                         [--sa-size N] [--iterations N]
+//
+
+#include "../accelerator/kernel_registry.h"
+#include "../accelerator/smm_gem.h"
+#include "../transformer_layers/addNorm.h"
+#include "../transformer_layers/layout.h"
+#include "../transformer_layers/softmax.h"
+#include "../transformer_layers/transpose.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <omp.h>
+
+#define W_DATA 4
+
+struct Shape {
+    std::size_t input_size;
+    std::size_t output_size;
+};
+
+// One measurement
+struct Result {
+    std::string kernel;
+    std::string layout;
+    int sa_size;
+    int cores;
+    std::size_t rows;
+    std::size_t input_size;
+    std::size_t output_size; // 0 if the kernel is not a GEMM
+    double seconds;
+    std::size_t bytes;       // data read and written by the kernel, at least once each
+    bool valid;
+};
+
+static std::vector<Result> results;
+
+static std::vector<uint32_t> randomWords(std::size_t words) {
+    std::vector<uint32_t> data(words);
+    for (auto &word : data) {
+        uint32_t value = 0;
+        for (int k = 0; k < W_DATA; k++) {
+            value |= ((uint8_t) (rand() % 5 - 2)) << (8 * k);
+        }
+        word = value;
+    }
+    return data;
+}
+
+// Shortest time of the runs, in seconds. prepare (e.g. clearing an accumulated output) is not timed.
+static double measure(const std::function<void()> &prepare, const std::function<void()> &kernel, int iterations) {
+    double best = 0;
+    for (int i = 0; i < iterations; i++) {
+        prepare();
+        auto start = std::chrono::steady_clock::now();
+        kernel();
+        std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+        best = (i == 0) ? time.count() : std::min(best, time.count());
+    }
+    return best;
+}
+
+static void record(const Result &result) {
+    results.push_back(result);
+    std::ostringstream shape;
+    shape << result.rows << "x" << result.input_size;
+    if (result.output_size)
+        shape << "x" << result.output_size;
+    std::cerr << std::left << std::setw(24) << result.kernel << std::setw(6) << result.layout << std::setw(4)
+              << result.cores << std::setw(16) << shape.str() << std::right << std::fixed << std::setprecision(4)
+              << std::setw(10) << result.seconds << " s" << std::setprecision(2) << std::setw(10)
+              << result.bytes / result.seconds / 1e9 << " GB/s";
+    if (result.output_size)
+        std::cerr << std::setw(10) << result.rows * result.input_size * result.output_size / result.seconds / 1e9
+                  << " GMAC/s";
+    std::cerr << (result.valid ? "" : "  MISMATCH") << std::endl;
+}
+
+static void printJson(std::ostream &os) {
+    os << "[" << std::endl;
+    for (std::size_t i = 0; i < results.size(); i++) {
+        const Result &r = results[i];
+        os << "  {\"kernel\": \"" << r.kernel << "\", \"layout\": \"" << r.layout << "\", \"sa_size\": " << r.sa_size
+           << ", \"cores\": " << r.cores << ", \"rows\": " << r.rows << ", \"input_size\": " << r.input_size
+           << ", \"output_size\": " << r.output_size << ", \"seconds\": " << std::setprecision(9) << r.seconds
+           << ", \"bytes_per_s\": " << std::setprecision(6) << r.bytes / r.seconds;
+        if (r.output_size)
+            os << ", \"gmac_per_s\": " << r.rows * r.input_size * r.output_size / r.seconds / 1e9;
+        os << ", \"valid\": " << (r.valid ? "true" : "false") << "}" << (i + 1 < results.size() ? "," : "")
+           << std::endl;
+    }
+    os << "]" << std::endl;
+}
+
+// The GEMM kernels of the registry (selected with config) on one shape, against the reference output
+static void benchmarkRegistry(const KernelConfig &config, std::size_t seq_len, const Shape &shape,
+                              const std::vector<uint32_t> &input, const std::vector<uint32_t> &weights,
+                              const std::vector<uint32_t> &reference, int iterations) {
+    if (!KernelRegistry::select(config))
+        return;
+    std::size_t maxCol = (config.backend == BACKEND_SIMD ? 16 : config.sa_size) / W_DATA;
+    std::size_t in_cols = shape.input_size / W_DATA;
+    std::size_t out_cols = shape.output_size / W_DATA;
+    std::size_t bytes = seq_len * shape.input_size + shape.input_size * shape.output_size +
+                        seq_len * shape.output_size;
+    std::string name = config.backend == BACKEND_SA ? "smmCompute" : "simdCompute";
+    std::vector<uint32_t> output(seq_len * out_cols), back(output.size());
+
+    if (config.backend == BACKEND_SIMD || smmTilesRWMA(shape.input_size, shape.output_size, config.sa_size)) {
+        double time = measure([&] { std::fill(output.begin(), output.end(), 0); }, [&] {
+            KernelRegistry::computeRWMA(seq_len, input.data(), output.data(), (uint32_t *) weights.data(),
+                                        shape.input_size, shape.output_size);
+        }, iterations);
+        record({name + "RWMA", "rwma", config.sa_size, config.core_num, seq_len, shape.input_size,
+                shape.output_size, time, bytes, output == reference});
+    }
+
+    std::vector<uint32_t> input_bw(input.size()), weights_bw(weights.size());
+    Layout::rowWiseToBlockWise(input.data(), input_bw.data(), seq_len, in_cols, maxCol);
+    Layout::rowWiseToBlockWise(weights.data(), weights_bw.data(), shape.input_size, out_cols, maxCol);
+    double time = measure([&] { std::fill(output.begin(), output.end(), 0); }, [&] {
+        KernelRegistry::computeBWMA(seq_len, input_bw.data(), output.data(), weights_bw.data(), shape.input_size,
+                                    shape.output_size);
+    }, iterations);
+    Layout::blockWiseToRowWise(output.data(), back.data(), seq_len, out_cols, maxCol);
+    record({name + "BWMA", "bwma", (int) maxCol * W_DATA, config.core_num, seq_len, shape.input_size,
+            shape.output_size, time, bytes, back == reference});
+}
+
+static void benchmarkGemm(std::size_t seq_len, const Shape &shape, const std::vector<int> &cores, int sa_size,
+                          int iterations) {
+    std::size_t out_cols = shape.output_size / W_DATA;
+    std::vector<uint32_t> input = randomWords(seq_len * shape.input_size / W_DATA);
+    std::vector<uint32_t> weights = randomWords(shape.input_size * out_cols);
+    std::vector<uint32_t> reference(seq_len * out_cols), output(reference.size());
+    std::size_t bytes = seq_len * shape.input_size + shape.input_size * shape.output_size +
+                        seq_len * shape.output_size;
+
+    // The reference and the tiled kernel are single-threaded
+    double time = measure([] {}, [&] {
+        conventionalCompute(seq_len, input.data(), reference.data(), weights.data(), shape.input_size,
+                            shape.output_size);
+    }, 1);
+    record({"conventionalCompute", "rwma", 0, 1, seq_len, shape.input_size, shape.output_size, time, bytes, true});
+
+    time = measure([&] { std::fill(output.begin(), output.end(), 0); }, [&] {
+        tiledCompute(seq_len, input.data(), output.data(), weights.data(), shape.input_size, shape.output_size);
+    }, iterations);
+    record({"tiledCompute", "rwma", 0, 1, seq_len, shape.input_size, shape.output_size, time, bytes,
+            output == reference});
+
+    for (int core_num : cores) {
+        benchmarkRegistry({BACKEND_SA, false, sa_size, core_num}, seq_len, shape, input, weights, reference,
+                          iterations);
+#ifdef SIMD
+        benchmarkRegistry({BACKEND_SIMD, false, 16, core_num}, seq_len, shape, input, weights, reference,
+                          iterations);
+#endif
+    }
+}
+
+// The layers around the GEMMs, row-wise and block-wise (the block-wise output is checked against the row-wise one)
+static void benchmarkLayers(std::size_t seq_len, std::size_t d_model, std::size_t head_size,
+                            const std::vector<int> &cores, int sa_size, int iterations) {
+    std::size_t maxCol = sa_size / W_DATA;
+    Softmax softmax;
+    AddNormalize addNorm(seq_len, d_model, sa_size, maxCol);
+
+    std::vector<uint32_t> scores = randomWords(seq_len * seq_len / W_DATA);
+    std::vector<uint32_t> residual = randomWords(seq_len * d_model / W_DATA);
+    std::vector<uint32_t> hidden = randomWords(seq_len * d_model / W_DATA);
+    std::vector<uint32_t> keys = randomWords(seq_len * head_size / W_DATA);
+    std::vector<uint32_t> scores_bw(scores.size()), residual_bw(residual.size()), hidden_bw(hidden.size());
+    std::vector<uint32_t> keys_bw(keys.size());
+    Layout::rowWiseToBlockWise(scores.data(), scores_bw.data(), seq_len, seq_len / W_DATA, maxCol);
+    Layout::rowWiseToBlockWise(residual.data(), residual_bw.data(), seq_len, d_model / W_DATA, maxCol);
+    Layout::rowWiseToBlockWise(hidden.data(), hidden_bw.data(), seq_len, d_model / W_DATA, maxCol);
+    Layout::rowWiseToBlockWise(keys.data(), keys_bw.data(), seq_len, head_size / W_DATA, maxCol);
+
+    for (int core_num : cores) {
+        omp_set_num_threads(core_num);
+        std::vector<uint32_t> out, out_bw, back;
+
+        // The layers work in place: each run starts again from the input
+        double time = measure([&] { out = scores; }, [&] { softmax.compute(out.data(), seq_len); }, iterations);
+        double time_bw = measure([&] { out_bw = scores_bw; }, [&] {
+            softmax.computeRearranged(out_bw.data(), seq_len, sa_size);
+        }, iterations);
+        back.resize(out.size());
+        Layout::blockWiseToRowWise(out_bw.data(), back.data(), seq_len, seq_len / W_DATA, maxCol);
+        record({"Softmax", "rwma", 0, core_num, seq_len, seq_len, 0, time, 2 * seq_len * seq_len, true});
+        record({"Softmax", "bwma", sa_size, core_num, seq_len, seq_len, 0, time_bw, 2 * seq_len * seq_len,
+                back == out});
+
+        time = measure([&] { out = hidden; }, [&] {
+            addNorm.compute(seq_len, residual.data(), out.data());
+        }, iterations);
+        time_bw = measure([&] { out_bw = hidden_bw; }, [&] {
+            addNorm.computeRearranged(seq_len, residual_bw.data(), out_bw.data());
+        }, iterations);
+        back.resize(out.size());
+        Layout::blockWiseToRowWise(out_bw.data(), back.data(), seq_len, d_model / W_DATA, maxCol);
+        record({"AddNormalize", "rwma", 0, core_num, seq_len, d_model, 0, time, 3 * seq_len * d_model, true});
+        record({"AddNormalize", "bwma", sa_size, core_num, seq_len, d_model, 0, time_bw, 3 * seq_len * d_model,
+                back == out});
+
+        // The transposed keys: [head_size, seq_len]
+        out.assign(keys.size(), 0);
+        out_bw.assign(keys.size(), 0);
+        time = measure([] {}, [&] { Transpose::transpose(keys.data(), out.data(), head_size, seq_len); },
+                       iterations);
+        time_bw = measure([] {}, [&] {
+            Transpose::transpose_rearranged(keys_bw.data(), out_bw.data(), head_size, seq_len, sa_size, maxCol);
+        }, iterations);
+        back.resize(out.size());
+        Layout::blockWiseToRowWise(out_bw.data(), back.data(), head_size, seq_len / W_DATA, maxCol);
+        // The transpose of the transpose is the matrix itself
+        std::vector<uint32_t> twice(keys.size());
+        Transpose::transpose(out.data(), twice.data(), seq_len, head_size);
+        record({"Transpose", "rwma", 0, core_num, seq_len, head_size, 0, time, 2 * seq_len * head_size,
+                twice == keys});
+        record({"Transpose", "bwma", sa_size, core_num, seq_len, head_size, 0, time_bw, 2 * seq_len * head_size,
+                back == out});
+
+        std::size_t cols = d_model / W_DATA;
+        out.assign(hidden.size(), 0);
+        back.assign(hidden.size(), 0);
+        time = measure([] {}, [&] {
+            Layout::rowWiseToBlockWise(hidden.data(), out.data(), seq_len, cols, maxCol);
+        }, iterations);
+        time_bw = measure([] {}, [&] {
+            Layout::blockWiseToRowWise(out.data(), back.data(), seq_len, cols, maxCol);
+        }, iterations);
+        record({"rowWiseToBlockWise", "rwma", sa_size, core_num, seq_len, d_model, 0, time, 2 * seq_len * d_model,
+                out == hidden_bw});
+        record({"blockWiseToRowWise", "bwma", sa_size, core_num, seq_len, d_model, 0, time_bw,
+                2 * seq_len * d_model, back == hidden});
+    }
+}
+
+static bool parseList(const std::string &text, std::vector<std::size_t> &values, char separator) {
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, separator)) {
+        try {
+            values.push_back(std::stoul(item));
+        } catch (const std::exception &) {
+            return false;
+        }
+    }
+    return !values.empty();
+}
+
+static void printUsage() {
+    std::cerr << "Usage: kernel_benchmark [--seq-len N] [--shapes 768x64,768x768,768x3072,3072x768] [--cores 1,2,4]"
+              << " [--sa-size N] [--iterations N]" << std::endl;
+}
+
+int main(int argc, char **argv) {
+    std::size_t seq_len = 512;
+    std::vector<Shape> shapes = {{768, 64}, {768, 768}, {768, 3072}, {3072, 768}};
+    std::vector<int> cores = {1, 2, 4};
+    int sa_size = SA_SIZE;
+    int iterations = 3;
+
+    for (int i = 1; i < argc; i += 2) {
+        std::string key = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << key << std::endl;
+            printUsage();
+            return 1;
+        }
+        std::string value = argv[i + 1];
+        std::vector<std::size_t> values;
+        bool valid = true;
+        if (key == "--seq-len") {
+            valid = parseList(value, values, ',') && values.size() == 1;
+            seq_len = valid ? values[0] : 0;
+        } else if (key == "--shapes") {
+            shapes.clear();
+            std::stringstream stream(value);
+            std::string item;
+            while (valid && std::getline(stream, item, ',')) {
+                values.clear();
+                valid = parseList(item, values, 'x') && values.size() == 2;
+                if (valid)
+                    shapes.push_back({values[0], values[1]});
+            }
+        } else if (key == "--cores") {
+            valid = parseList(value, values, ',');
+            cores.assign(values.begin(), values.end());
+        } else if (key == "--sa-size") {
+            valid = parseList(value, values, ',') && values.size() == 1;
+            sa_size = valid ? (int) values[0] : 0;
+        } else if (key == "--iterations") {
+            valid = parseList(value, values, ',') && values.size() == 1 && values[0] > 0;
+            iterations = valid ? (int) values[0] : 0;
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            std::cerr << "Invalid argument: " << key << " " << value << std::endl;
+            printUsage();
+            return 1;
+        }
+    }
+    for (int core_num : cores) {
+        if (core_num < 1 || core_num > MAX_CORE_NUM) {
+            std::cerr << "The core counts must be between 1 and " << MAX_CORE_NUM << std::endl;
+            return 1;
+        }
+    }
+    // The SA kernels and the block-wise layers tile every dimension, the NEON kernels need 16x16 tiles
+    std::size_t tile = std::max(sa_size, 16);
+    for (const Shape &shape : shapes) {
+        if (seq_len % tile != 0 || shape.input_size % tile != 0 || shape.output_size % tile != 0) {
+            std::cerr << "The shapes must be multiples of " << tile << std::endl;
+            return 1;
+        }
+    }
+    if (!KernelRegistry::select({BACKEND_SA, false, sa_size, 1})) {
+        std::cerr << "No SA kernels of size " << sa_size << " (available: " << KernelRegistry::available() << ")"
+                  << std::endl;
+        return 1;
+    }
+
+    srand(1);
+    for (const Shape &shape : shapes) {
+        benchmarkGemm(seq_len, shape, cores, sa_size, iterations);
+    }
+    // The first shape is a projection of the attention: [d_model, head_size]
+    std::size_t d_model = shapes[0].input_size;
+    std::size_t head_size = shapes[0].output_size;
+    benchmarkLayers(seq_len, d_model, head_size, cores, sa_size, iterations);
+
+    printJson(std::cout);
+    for (const Result &result : results) {
+        if (!result.valid)
+            return 1;
+    }
+    return 0;
+}
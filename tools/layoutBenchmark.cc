@@ -0,0 +1,112 @@
+//
+// Throughput of the memory arrangement conversions (see transformer_layers/layout.h) against memcpy, which is the
+// memory bandwidth bound. Every conversion is also checked against a simple reference.
+// This is a host tool: build it with `make layout-bench`.
+//
+// Usage: layout_benchmark [n_row n_col_int8] [iterations]
+//
+
+#include "../transformer_layers/layout.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+#include <omp.h>
+
+#define W_DATA 4
+
+static void referenceRowWiseToBlockWise(const uint32_t *rowWise, uint32_t *blockWise, std::size_t n_row,
+                                        std::size_t n_col, std::size_t maxCol) {
+    for (std::size_t col = 0; col < n_col / maxCol; col++) {
+        for (std::size_t row = 0; row < n_row; row++) {
+            for (std::size_t i = 0; i < maxCol; i++) {
+                *blockWise++ = rowWise[row * n_col + col * maxCol + i];
+            }
+        }
+    }
+}
+
+// Average time of a conversion, in seconds
+static double measure(const std::function<void()> &conversion, int iterations) {
+    conversion(); // warm up
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        conversion();
+    }
+    std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+    return time.count() / iterations;
+}
+
+static void report(const std::string &name, std::size_t bytes, double time, double memcpy_time, bool valid) {
+    // Every byte is read once and written once
+    std::cout << std::left << std::setw(36) << name << std::right << std::fixed << std::setprecision(2)
+              << std::setw(10) << 2.0 * bytes / time / 1e9 << " GB/s" << std::setw(8)
+              << 100.0 * memcpy_time / time << " % of memcpy" << (valid ? "" : "  MISMATCH") << std::endl;
+}
+
+int main(int argc, char **argv) {
+    std::size_t n_row = 3072;
+    std::size_t n_col_int8 = 768;
+    int iterations = 20;
+    if (argc >= 3) {
+        n_row = std::stoul(argv[1]);
+        n_col_int8 = std::stoul(argv[2]);
+    }
+    if (argc >= 4)
+        iterations = std::stoi(argv[3]);
+
+    std::size_t n_col = n_col_int8 / W_DATA;
+    std::size_t words = n_row * n_col;
+    std::size_t bytes = words * sizeof(uint32_t);
+    std::vector<uint32_t> input(words), output(words), reference(words), back(words);
+    for (auto &word : input) {
+        word = (uint32_t) rand();
+    }
+    std::cout << n_row << " x " << n_col_int8 << " int8 (" << bytes / 1024 << " KiB), " << omp_get_max_threads()
+              << " threads" << std::endl;
+
+    double memcpy_time = measure([&] { memcpy(output.data(), input.data(), bytes); }, iterations);
+    report("memcpy", bytes, memcpy_time, memcpy_time, true);
+
+    for (std::size_t kernelSize = 4; kernelSize <= 64; kernelSize *= 2) {
+        if (n_row % kernelSize != 0 || n_col_int8 % kernelSize != 0)
+            continue;
+        std::size_t maxCol = kernelSize / W_DATA;
+        std::string size = " (" + std::to_string(kernelSize) + ")";
+        referenceRowWiseToBlockWise(input.data(), reference.data(), n_row, n_col, maxCol);
+
+        double time = measure([&] {
+            Layout::rowWiseToBlockWise(input.data(), output.data(), n_row, n_col, maxCol);
+        }, iterations);
+        report("rowWiseToBlockWise" + size, bytes, time, memcpy_time, output == reference);
+
+        time = measure([&] {
+            Layout::blockWiseToRowWise(reference.data(), back.data(), n_row, n_col, maxCol);
+        }, iterations);
+        report("blockWiseToRowWise" + size, bytes, time, memcpy_time, back == input);
+
+        // Converting back and forth keeps the data valid across the iterations
+        back = input;
+        time = measure([&] {
+            Layout::rowWiseToBlockWiseInPlace(back.data(), n_row, n_col, maxCol);
+            Layout::blockWiseToRowWiseInPlace(back.data(), n_row, n_col, maxCol);
+        }, iterations) / 2;
+        report("in place, both ways" + size, bytes, time, memcpy_time, back == input);
+
+        time = measure([&] {
+            Layout::blockWiseToTransposed(reference.data(), output.data(), n_col_int8, n_row, kernelSize);
+        }, iterations);
+        // The transpose of the transpose is the matrix itself
+        Layout::blockWiseToTransposed(output.data(), back.data(), n_row, n_col_int8, kernelSize);
+        report("blockWiseToTransposed" + size, bytes, time, memcpy_time, back == reference);
+    }
+
+    double time = measure([&] {
+        Layout::rowWiseToTransposed(input.data(), output.data(), n_col_int8, n_row);
+    }, iterations);
+    Layout::rowWiseToTransposed(output.data(), back.data(), n_row, n_col_int8);
+    report("rowWiseToTransposed", bytes, time, memcpy_time, back == input);
+    return 0;
+}
@@ -0,0 +1,221 @@
+//
+// Replay of an SA instruction trace (accelerator/sa_trace.h, recorded with --sa_trace by a DEVELOP build of the
+// transformer) on the host model of the SA, without gem5. Each core of the trace drives its own
+// SystolicMatrixMultiplication model, on its own thread, with a latency per instruction; the cores wait for each
+// other at the end of each parallel GEMM (the barriers of the trace). The replay reports the cycles, the
+// utilization of each SA (beats streamed, and beats with a non-zero input row, against all the cycles) and the
+// time the cores wait for each other, so that the latencies of the accelerator can be explored in seconds.
+// The results are written as JSON on stdout and a readable summary on stderr.
+// This is a host tool: build it with `make sa-replay` or with the sa_replay target of CMake.
+//
+// Usage: sa_replay <trace> [--param-write N] [--queue N] [--stream N] [--issue N] [--threads N]
+//   --param-write, --queue, --stream: cycles of each SA instruction (1 by default)
+//   --issue: cycles of the processor between two SA instructions (loads, stores, accumulation; 1 by default)
+//   --threads: host threads of the replay (the number of cores of the trace by default)
+//
+
+#include "../accelerator/sa_trace.h"
+#include "../accelerator/systolic_m2m.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <omp.h>
+
+struct Latencies {
+    uint64_t param_write = 1;
+    uint64_t queue = 1;
+    uint64_t stream = 1;
+    uint64_t issue = 1;
+};
+
+struct CoreStats {
+    uint64_t param_writes = 0;
+    uint64_t queues = 0;
+    uint64_t streams = 0;
+    uint64_t zero_rows = 0;   // beats whose input row is all zero (SA drain, padding)
+    uint64_t tiles = 0;       // weight tiles loaded
+    uint64_t zero_tiles = 0;
+    uint64_t busy_cycles = 0; // cycles of the instructions of this core
+    uint64_t wait_cycles = 0; // cycles waiting for the other cores at the barriers
+    uint32_t checksum = 0;    // of the outputs of the model, to compare replays
+};
+
+// State of the replay of one core
+template <int KERNEL_DIM>
+struct CoreReplay {
+    SystolicMatrixMultiplication<KERNEL_DIM> model;
+    CoreStats stats;
+    bool loading = false;
+    bool tile_non_zero = false;
+    bool row_non_zero = false;
+
+    // Replays the records and returns their cycles
+    uint64_t run(const std::vector<SaTraceRecord> &records, const Latencies &latencies) {
+        uint64_t cycles = 0;
+        uint32_t output;
+        for (const SaTraceRecord &record : records) {
+            cycles += latencies.issue;
+            if (record.op != SA_OP_PARAM_WRITE && loading) {
+                stats.tiles++;
+                stats.zero_tiles += !tile_non_zero;
+                loading = false;
+            }
+            switch (record.op) {
+                case SA_OP_PARAM_WRITE:
+                    if (!loading) {
+                        loading = true;
+                        tile_non_zero = false;
+                    }
+                    tile_non_zero |= record.value != 0;
+                    model.loadWeights(record.index, record.value);
+                    stats.param_writes++;
+                    cycles += latencies.param_write;
+                    break;
+                case SA_OP_QUEUE:
+                    row_non_zero |= record.value != 0;
+                    output = model.inputQueue(record.index, record.value);
+                    stats.checksum = (stats.checksum ^ output) * 16777619u;
+                    stats.queues++;
+                    cycles += latencies.queue;
+                    break;
+                default:
+                    stats.zero_rows += !(row_non_zero || record.value != 0);
+                    row_non_zero = false;
+                    output = model.streamInOut(record.value);
+                    stats.checksum = (stats.checksum ^ output) * 16777619u;
+                    stats.streams++;
+                    cycles += latencies.stream;
+                    break;
+            }
+        }
+        stats.busy_cycles += cycles;
+        return cycles;
+    }
+};
+
+template <int KERNEL_DIM>
+static int replay(SaTraceReader &reader, const Latencies &latencies, int threads) {
+    int core_num = reader.coreNum();
+    std::vector<std::unique_ptr<CoreReplay<KERNEL_DIM>>> cores;
+    for (int c = 0; c < core_num; c++) {
+        cores.emplace_back(new CoreReplay<KERNEL_DIM>());
+    }
+
+    // The segments of the trace are the parallel GEMMs: every core starts at the last barrier, and the next barrier
+    // is when the slowest one is done
+    auto start = std::chrono::steady_clock::now();
+    uint64_t cycles = 0;
+    uint64_t segments = 0;
+    std::vector<std::vector<SaTraceRecord>> records;
+    std::vector<uint64_t> segment_cycles(core_num);
+    while (reader.nextSegment(records)) {
+#pragma omp parallel for num_threads(threads) schedule(dynamic, 1)
+        for (int c = 0; c < core_num; c++) {
+            segment_cycles[c] = cores[c]->run(records[c], latencies);
+        }
+        uint64_t longest = *std::max_element(segment_cycles.begin(), segment_cycles.end());
+        for (int c = 0; c < core_num; c++) {
+            cores[c]->stats.wait_cycles += longest - segment_cycles[c];
+        }
+        cycles += longest;
+        segments++;
+    }
+    std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+
+    std::cout << "{\"sa_size\": " << KERNEL_DIM << ", \"cores\": " << core_num << ", \"segments\": " << segments
+              << ", \"cycles\": " << cycles << ", \"latencies\": {\"param_write\": " << latencies.param_write
+              << ", \"queue\": " << latencies.queue << ", \"stream\": " << latencies.stream << ", \"issue\": "
+              << latencies.issue << "}, \"replay_seconds\": " << time.count() << "," << std::endl
+              << " \"per_core\": [" << std::endl;
+    std::cerr << "SA " << KERNEL_DIM << "x" << KERNEL_DIM << ", " << core_num << " cores, " << segments
+              << " GEMMs, " << cycles << " cycles (replayed in " << std::fixed << std::setprecision(2) << time.count()
+              << " s)" << std::endl;
+    std::cerr << std::setw(5) << "core" << std::setw(14) << "param writes" << std::setw(14) << "queues"
+              << std::setw(14) << "streams" << std::setw(10) << "tiles" << std::setw(12) << "zero tiles"
+              << std::setw(8) << "util %" << std::setw(8) << "MAC %" << std::setw(8) << "wait %" << std::endl;
+    for (int c = 0; c < core_num; c++) {
+        const CoreStats &s = cores[c]->stats;
+        double utilization = cycles ? (double) (s.streams * latencies.stream) / (double) cycles : 0.0;
+        double mac_utilization = cycles ? (double) ((s.streams - s.zero_rows) * latencies.stream) / (double) cycles
+                                        : 0.0;
+        double wait = cycles ? (double) s.wait_cycles / (double) cycles : 0.0;
+        std::cout << "  {\"core\": " << c << ", \"param_writes\": " << s.param_writes << ", \"queues\": " << s.queues
+                  << ", \"streams\": " << s.streams << ", \"zero_rows\": " << s.zero_rows << ", \"tiles\": "
+                  << s.tiles << ", \"zero_tiles\": " << s.zero_tiles << ", \"busy_cycles\": " << s.busy_cycles
+                  << ", \"wait_cycles\": " << s.wait_cycles << ", \"utilization\": " << utilization
+                  << ", \"mac_utilization\": " << mac_utilization << ", \"checksum\": " << s.checksum << "}"
+                  << (c + 1 < core_num ? "," : "") << std::endl;
+        std::cerr << std::setw(5) << c << std::setw(14) << s.param_writes << std::setw(14) << s.queues
+                  << std::setw(14) << s.streams << std::setw(10) << s.tiles << std::setw(12) << s.zero_tiles
+                  << std::setprecision(1) << std::setw(8) << 100 * utilization << std::setw(8)
+                  << 100 * mac_utilization << std::setw(8) << 100 * wait << std::endl;
+    }
+    std::cout << "]}" << std::endl;
+    return 0;
+}
+
+static void printUsage() {
+    std::cerr << "Usage: sa_replay <trace> [--param-write N] [--queue N] [--stream N] [--issue N] [--threads N]"
+              << std::endl;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        printUsage();
+        return 1;
+    }
+    Latencies latencies;
+    int threads = 0;
+    for (int i = 2; i < argc; i += 2) {
+        std::string key = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << key << std::endl;
+            printUsage();
+            return 1;
+        }
+        uint64_t value;
+        try {
+            value = std::stoul(argv[i + 1]);
+        } catch (const std::exception &) {
+            std::cerr << "Invalid argument: " << key << " " << argv[i + 1] << std::endl;
+            printUsage();
+            return 1;
+        }
+        if (key == "--param-write") {
+            latencies.param_write = value;
+        } else if (key == "--queue") {
+            latencies.queue = value;
+        } else if (key == "--stream") {
+            latencies.stream = value;
+        } else if (key == "--issue") {
+            latencies.issue = value;
+        } else if (key == "--threads" && value > 0) {
+            threads = (int) value;
+        } else {
+            std::cerr << "Invalid argument: " << key << " " << argv[i + 1] << std::endl;
+            printUsage();
+            return 1;
+        }
+    }
+
+    SaTraceReader reader;
+    if (!reader.open(argv[1]))
+        return 1;
+    if (threads == 0)
+        threads = reader.coreNum();
+    switch (reader.saSize()) {
+        case 4:
+            return replay<4>(reader, latencies, threads);
+        case 8:
+            return replay<8>(reader, latencies, threads);
+        case 16:
+            return replay<16>(reader, latencies, threads);
+        case 32:
+            return replay<32>(reader, latencies, threads);
+        default:
+            std::cerr << "No host model of the SA of size " << reader.saSize() << std::endl;
+            return 1;
+    }
+}
@@ -0,0 +1,137 @@
+//
+// Offline weight packer: rewrites a weight container (see transformer_layers/weightContainer.h) in the memory
+// arrangement and SA size of a target build, so that the simulated binary maps it without any layout work.
+// This is a host tool: build it with `make packer`.
+//
+// Usage: weight_packer <input.sat> <output.sat> [--layout rwma|bwma] [--sa-size N] [--zero-tile-flags] [--verify]
+// --zero-tile-flags adds a byte per sa_size x sa_size tile of each weight, 0 if the tile is all zeros. The kernels do
+// not read these flags: they are metadata for external tools (e.g. to study the sparsity of a checkpoint).
+//
+
+#include "../transformer_layers/layout.h"
+#include "../transformer_layers/weightContainer.h"
+#include <cstring>
+#include <iostream>
+
+#define W_DATA 4
+
+// One byte per sa_size x sa_size tile of a row-wise matrix, 0 if all the weights of the tile are 0
+static void zeroTileMask(const uint32_t *rowWise, uint8_t *mask, int n_row, int n_col, int saSize) {
+    int maxCol = saSize / W_DATA;
+    for (int i = 0; i < n_row / saSize; i++) {
+        for (int j = 0; j < n_col / maxCol; j++) {
+            uint8_t non_zero = 0;
+            for (int ii = 0; ii < saSize && !non_zero; ii++) {
+                for (int jj = 0; jj < maxCol; jj++) {
+                    if (rowWise[(i * saSize + ii) * n_col + j * maxCol + jj] != 0) {
+                        non_zero = 1;
+                        break;
+                    }
+                }
+            }
+            mask[i * (n_col / maxCol) + j] = non_zero;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <input.sat> <output.sat> [--layout rwma|bwma] [--sa-size N] [--zero-tile-flags] [--verify]"
+                  << std::endl;
+        return 1;
+    }
+    std::string input_file = argv[1];
+    std::string output_file = argv[2];
+    WeightLayout layout = LAYOUT_BWMA;
+    int sa_size = 16;
+    bool zero_tile_flags = false;
+    bool verify = false;
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--layout" && i + 1 < argc) {
+            std::string value = argv[++i];
+            if (value != "rwma" && value != "bwma") {
+                std::cerr << "Invalid layout: " << value << " (rwma or bwma)" << std::endl;
+                return 1;
+            }
+            layout = (value == "rwma") ? LAYOUT_RWMA : LAYOUT_BWMA;
+        } else if (arg == "--sa-size" && i + 1 < argc) {
+            sa_size = std::atoi(argv[++i]);
+        } else if (arg == "--zero-tile-flags") {
+            zero_tile_flags = true;
+        } else if (arg == "--verify") {
+            verify = true;
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return 1;
+        }
+    }
+    // The SA sizes of the kernels (see accelerator/kernel_registry.cc): a container packed for another size
+    // could never be mapped as it is
+    if (sa_size != 4 && sa_size != 8 && sa_size != 16 && sa_size != 32) {
+        std::cerr << "Invalid SA size: " << sa_size << " (the kernels support 4, 8, 16 and 32)" << std::endl;
+        return 1;
+    }
+
+    WeightContainer input;
+    if (!input.open(input_file, verify))
+        return 1;
+
+    WeightContainerWriter writer;
+    std::vector<std::vector<uint32_t>> tensors;
+    std::vector<std::vector<uint8_t>> masks;
+    tensors.reserve(input.numTensors());
+    masks.reserve(input.numTensors());
+    for (uint32_t t = 0; t < input.numTensors(); t++) {
+        const WeightTensorEntry *entry = input.entry(t);
+        if (entry->dtype == DTYPE_INT32) {
+            // The biases do not depend on the memory arrangement: they are copied as they are
+            writer.addBias(entry->layer, entry->index & ~WEIGHT_INDEX_BIAS, (const int32_t *) input.data(entry),
+                           (int) entry->n_col);
+            continue;
+        }
+        if (entry->dtype != DTYPE_INT8X4)
+            continue; // the zero-tile masks are computed again for the target SA size
+        int n_row = (int) entry->n_row;
+        int n_col = (int) entry->n_col >> 2;
+        auto *data = (const uint32_t *) input.data(entry);
+        if (n_row % sa_size != 0 || entry->n_col % sa_size != 0) {
+            std::cerr << "Layer " << entry->layer << " tensor " << entry->index << " (" << entry->n_row << "x"
+                      << entry->n_col << ") is not a multiple of the SA size" << std::endl;
+            return 1;
+        }
+
+        std::vector<uint32_t> rowWise(n_row * n_col);
+        if (entry->layout == LAYOUT_RWMA) {
+            memcpy(rowWise.data(), data, rowWise.size() * sizeof(uint32_t));
+        } else {
+            Layout::blockWiseToRowWise(data, rowWise.data(), n_row, n_col, entry->sa_size / W_DATA);
+        }
+
+        if (zero_tile_flags) {
+            masks.emplace_back((n_row / sa_size) * (entry->n_col / sa_size));
+            zeroTileMask(rowWise.data(), masks.back().data(), n_row, n_col, sa_size);
+        }
+
+        if (layout == LAYOUT_RWMA) {
+            tensors.push_back(std::move(rowWise));
+        } else {
+            std::vector<uint32_t> blockWise(n_row * n_col);
+            Layout::rowWiseToBlockWise(rowWise.data(), blockWise.data(), n_row, n_col, sa_size / W_DATA);
+            tensors.push_back(std::move(blockWise));
+        }
+
+        writer.add(entry->layer, entry->index, tensors.back().data(), n_row, (int) entry->n_col, layout, sa_size);
+        if (zero_tile_flags) {
+            writer.addTileMask(entry->layer, entry->index, masks.back().data(), n_row / sa_size,
+                               (int) entry->n_col / sa_size, layout, sa_size);
+        }
+    }
+
+    if (!writer.save(output_file))
+        return 1;
+    std::cout << "Packed " << tensors.size() << " tensors for " << (layout == LAYOUT_RWMA ? "RWMA" : "BWMA")
+              << " and SA size " << sa_size << " in " << output_file << std::endl;
+    return 0;
+}
@@ -1,13 +1,18 @@
-#include "transformer_layers/transformerBlock.h"
+#include "transformer_layers/transformerEncoder.h"
 //#include"gtest/gtest.h"
 #include "transformer.h"
 #include "accelerator/smm_gem.h"
-#include <fstream>
+#include "accelerator/sa_trace.h"
+#include <chrono>
+#include <filesystem>
+#include <algorithm>
 
 #include "transformer_layers/debuggerFunctions.h"
-
-#define KERNEL_DIM SA_SIZE
-#define MAX_COL (SA_SIZE/4)
+#include "transformer_layers/layout.h"
+#include "transformer_layers/modelConfig.h"
+#include "transformer_layers/opCounter.h"
+#include "transformer_layers/roi.h"
+#include "transformer_layers/weightContainer.h"
 
 
 void fill_kernel(uint32_t *kernel, int kernel_size) {
@@ -20,12 +25,12 @@ void fill_kernel(uint32_t *kernel, int kernel_size) {
     }
 }
 
-void fill_weight(uint32_t *kernel, int n_row, int n_col) {
+void fill_weight(uint32_t *kernel, int n_row, int n_col, int kernelDim, int maxCol) {
     uint32_t *kernel_ptr = kernel;
-    for (int i = 0; i < n_row / KERNEL_DIM; i++) {
-        for (int j = 0; j < n_col / MAX_COL; j++) {
-            for (int ii = 0; ii < KERNEL_DIM; ii++) {
-                for (int jj = 0; jj < MAX_COL; jj++) {
+    for (int i = 0; i < n_row / kernelDim; i++) {
+        for (int j = 0; j < n_col / maxCol; j++) {
+            for (int ii = 0; ii < kernelDim; ii++) {
+                for (int jj = 0; jj < maxCol; jj++) {
                     uint32_t result = 0;
                     for (int k = 0; k < 4; k++) {
                         result |= ((uint8_t) (rand() % 5 - 2)) << (8 * k);
@@ -38,151 +43,287 @@ void fill_weight(uint32_t *kernel, int n_row, int n_col) {
     }
 }
 
-void saveWeight(int n_head, int qkv, int size, uint32_t *array, const std::string &dir_name) {
-    // Write the kernel array to file
-    std::string filename = dir_name + "/H" + std::to_string(n_head) + "_L" +
-                           std::to_string(qkv) + ".bin";
-    std::ofstream fout(filename);
-    if (fout.is_open()) {
-        for (int i = 0; i < size; i++) {
-            fout << array[i] << " ";
-        }
-        fout.close();
-    }
+// Memory arrangement of the tensors for the selected kernels
+WeightLayout modelLayout(const ModelConfig &config) {
+    return config.kernel.bwma ? LAYOUT_BWMA : LAYOUT_RWMA;
 }
 
-void loadWeight(int n_head, int qkv, int size, uint32_t *array, const std::string &dir_name) {
-    std::string filename = dir_name + "/H" + std::to_string(n_head) + "_L" +
-            std::to_string(qkv) + ".bin";
-    std::ifstream fin(filename);
-    if (fin.is_open()) {
-        for (int i = 0; i < size; i++) {
-            fin >> array[i];
-        }
-        fin.close();
+// Shape (in int8 elements) of the weight matrix at the given index of the weightVector of a layer
+void weightShape(const ModelConfig &config, int index, int &n_row, int &n_col) {
+    int num_heads = (int) config.num_heads;
+    if (index < 3 * num_heads) {
+        n_row = (int) config.d_model;
+        n_col = (int) config.head_size;
+    } else if (index == 3 * num_heads) {
+        n_row = (int) (config.num_heads * config.head_size);
+        n_col = (int) config.d_model;
+    } else if (index == 3 * num_heads + 1) {
+        n_row = (int) config.d_model;
+        n_col = (int) config.ff_size;
     } else {
-        std::cout << filename + " Not loaded" << std::endl;
+        n_row = (int) config.ff_size;
+        n_col = (int) config.d_model;
     }
 }
 
-void test() {
-    std::cout << "Welcome to TiC-SAT" << std::endl;
-#ifdef BWMA
-    std::cout << "BWMA method" << std::endl;
-#else
-    std::cout<<"RWMA method" << std::endl;
-#endif
-
-    // The directory where the weights are saved
-    // Change this to the directory where you want to save/load the weights
-    std::string dir_name = "/path/to/weight/directory";
+// The multi-MB matrices (e.g. the feed-forward weights) are put on hugepages to cut the TLB misses
+TensorMemory matrixMemory(int n_row, int n_col) {
+    return (std::size_t) n_row * n_col >= TENSOR_HUGEPAGE_SIZE ? MEMORY_HUGEPAGE : MEMORY_ALIGNED;
+}
 
-    uint32_t *tensor_in = new uint32_t[D_SEQ * D_MODEL >> 2];
-#ifdef RELOAD_WEIGHT
-    // Load the tensor input from file
-    // We assign -1 and -1 to n_head and qkv to indicate that we are not loading the weight
-    loadWeight(-1, -1, D_SEQ * D_MODEL >> 2, tensor_in, dir_name);
-#else
-    fill_kernel(tensor_in, D_SEQ * D_MODEL >> 2);
-    // Save the tensor input to file
-    // We assign -1 and -1 to n_head and qkv to indicate that we are not saving the weight
-    saveWeight(-1, -1, D_SEQ * D_MODEL >> 2, tensor_in, dir_name);
-#endif
+Tensor generateMatrix(const ModelConfig &config, int n_row, int n_col) {
+    int kernelDim = config.kernel.sa_size;
+    Tensor matrix(n_row, n_col, LAYOUT_BWMA, matrixMemory(n_row, n_col));
+    fill_weight(matrix.data(), n_row, n_col >> 2, kernelDim, kernelDim / 4);
+    if (!config.kernel.bwma) {
+        // By default, the weights are generated in block-wise format
+        // We need to convert them to row-wise format
+        Tensor rowWise(n_row, n_col, LAYOUT_RWMA, matrixMemory(n_row, n_col));
+        Layout::blockWiseToRowWise(matrix.data(), rowWise.data(), n_row, n_col >> 2, kernelDim / 4);
+        matrix = std::move(rowWise);
+    }
+    return matrix;
+}
 
-#ifndef BWMA
-    uint32_t tensorInRowWise[D_SEQ * D_MODEL >> 2];
-    // By default, the saved tensor is in block-wise format
-    // We need to convert it to row-wise format
-    blockWise2RowWise(tensor_in, tensorInRowWise, D_SEQ, D_MODEL >> 2);
-    tensor_in = tensorInRowWise;
-#endif
+// True if the tensor of the container can be used as is by the selected kernels
+bool matchesLayout(const ModelConfig &config, const WeightTensorEntry *entry) {
+    return entry->layout == modelLayout(config) &&
+           (entry->layout == LAYOUT_RWMA || (int) entry->sa_size == config.kernel.sa_size);
+}
 
-    uint32_t *out = new uint32_t[D_SEQ * D_MODEL >> 2]();
-    uint32_t *weightVec[3 * NUM_HEAD + 3];
-    int head_qkv_size = D_Q * D_MODEL >> 2;
+// Copies the tensor into matrix, in the memory arrangement of the selected kernels
+void readMatrix(const ModelConfig &config, const WeightContainer &container, int layer, int index, int n_row,
+                int n_col, uint32_t *matrix) {
+    const WeightTensorEntry *entry = container.find(layer, index);
+    if (entry == nullptr || (int) entry->n_row != n_row || (int) entry->n_col != n_col ||
+        entry->dtype != DTYPE_INT8X4) {
+        std::cout << "Layer " << layer << " tensor " << index << " Not loaded" << std::endl;
+        std::fill(matrix, matrix + (n_row * n_col >> 2), 0);
+        return;
+    }
 
-    for (int n = 0; n < NUM_HEAD; n++) {
-        volatile auto query_kernel = new uint32_t[D_Q * D_MODEL >> 2]();
-        volatile auto key_kernel = new uint32_t[D_Q * D_MODEL >> 2]();
-        volatile auto value_kernel = new uint32_t[D_Q * D_MODEL >> 2]();
+    uint32_t *data = container.tensor(layer, index);
+    std::size_t words = n_row * n_col >> 2;
+    if (matchesLayout(config, entry)) {
+        std::copy(data, data + words, matrix);
+        return;
+    }
 
-#ifdef RELOAD_WEIGHT
-        loadWeight(n, 0, head_qkv_size, query_kernel, dir_name);
-        loadWeight(n, 1, head_qkv_size, key_kernel, dir_name);
-        loadWeight(n, 2, head_qkv_size, value_kernel, dir_name);
-#else
-        fill_weight(query_kernel, D_MODEL, D_Q >> 2);
-        fill_weight(key_kernel, D_MODEL, D_Q >> 2);
-        fill_weight(value_kernel,  D_MODEL, D_Q >> 2);
+    // The container was written for another memory arrangement or SA size: go through row-wise
+    std::vector<uint32_t> rowWise;
+    const uint32_t *rowWiseData = data;
+    if (entry->layout == LAYOUT_BWMA) {
+        rowWise.resize(words);
+        Layout::blockWiseToRowWise(data, rowWise.data(), n_row, n_col >> 2, entry->sa_size / 4);
+        rowWiseData = rowWise.data();
+    }
+    if (config.kernel.bwma) {
+        Layout::rowWiseToBlockWise(rowWiseData, matrix, n_row, n_col >> 2, config.kernel.sa_size / 4);
+    } else {
+        std::copy(rowWiseData, rowWiseData + words, matrix);
+    }
+}
 
-        saveWeight(n, 0, head_qkv_size, query_kernel, dir_name);
-        saveWeight(n, 1, head_qkv_size, key_kernel, dir_name);
-        saveWeight(n, 2, head_qkv_size, value_kernel, dir_name);
-#endif
+Tensor loadMatrix(const ModelConfig &config, const WeightContainer &container, int layer, int index, int n_row,
+                  int n_col) {
+    const WeightTensorEntry *entry = container.find(layer, index);
+    if (entry != nullptr && (int) entry->n_row == n_row && (int) entry->n_col == n_col &&
+        entry->dtype == DTYPE_INT8X4 && matchesLayout(config, entry)) {
+        // Zero copy: the tensor is a view of the mapping
+        return Tensor::view(container.tensor(layer, index), n_row, n_col, modelLayout(config));
+    }
 
-#ifndef BWMA
-        // By default, the saved weights are in block-wise format
-        // We need to convert them to row-wise format
-        uint32_t* queryRowWise = new uint32_t [D_MODEL * D_Q >> 2];
-        blockWise2RowWise(query_kernel, queryRowWise, D_MODEL, D_Q >> 2);
-        query_kernel = queryRowWise;
-        uint32_t* keyRowWise = new uint32_t [D_MODEL * D_Q >> 2];
-        blockWise2RowWise(key_kernel, keyRowWise, D_MODEL, D_Q >> 2);
-        key_kernel = keyRowWise;
-        uint32_t* valueRowWise = new uint32_t [D_MODEL * D_Q >> 2];
-        blockWise2RowWise(value_kernel, valueRowWise, D_MODEL, D_Q >> 2);
-        value_kernel = valueRowWise;
-#endif
+    // Missing, or the container was written for another memory arrangement
+    Tensor matrix(n_row, n_col, modelLayout(config), matrixMemory(n_row, n_col));
+    readMatrix(config, container, layer, index, n_row, n_col, matrix.data());
+    return matrix;
+}
 
-        weightVec[n * 3] = query_kernel;
-        weightVec[n * 3 + 1] = key_kernel;
-        weightVec[n * 3 + 2] = value_kernel;
+// The bias of the weights in the mapping, nullptr if the container does not have it (or not with their columns)
+int32_t *loadBias(const ModelConfig &config, const WeightContainer &container, int layer, int index) {
+    const WeightTensorEntry *entry = container.findBias(layer, index);
+    if (entry == nullptr)
+        return nullptr;
+    int n_row, n_col;
+    weightShape(config, index, n_row, n_col);
+    if ((int) entry->n_col != n_col) {
+        std::cout << "Layer " << layer << " bias " << index << " Not loaded" << std::endl;
+        return nullptr;
     }
+    return container.bias(layer, index);
+}
+
+void test(const ModelConfig &config) {
+    std::cout << "Welcome to TiC-SAT" << std::endl;
+    config.print(std::cout);
 
-    volatile auto condense_kernel = new uint32_t[NUM_HEAD * D_Q * D_MODEL >> 2]();
-    volatile auto ff0_kernel = new uint32_t[D_MODEL * D_FF >> 2]();
-    volatile auto ff1_kernel = new uint32_t[D_FF * D_MODEL >> 2]();
+    // The directory where the weights are saved
+    // Change it with --weight-dir to the directory where you want to save/load the weights
+    std::string weight_file = config.weight_dir + "/weights.sat";
+    WeightLayout layout = modelLayout(config);
+    int sa_size = config.kernel.sa_size;
+    int num_layers = (int) config.num_layers;
+    int layer_weights = 3 * (int) config.num_heads + 3;
+
+    Tensor tensor_in;
+    Tensor out(config.batch * config.seq_len, config.d_model, layout);
+    // The weights (owned, or views of the container) and the weightVector of every layer, pointing to them
+    std::vector<Tensor> weights;
+    std::vector<uint32_t *> weightPointers(num_layers * layer_weights);
+    std::vector<uint32_t **> weightVecs(num_layers);
+    for (int l = 0; l < num_layers; l++) {
+        weightVecs[l] = weightPointers.data() + l * layer_weights;
+    }
+    // The biases are optional: the generated weights have none, a container may have some
+    std::vector<int32_t *> biasPointers(num_layers * layer_weights, nullptr);
+    std::vector<int32_t **> biasVecs(num_layers);
+    bool has_bias = false;
+    for (int l = 0; l < num_layers; l++) {
+        biasVecs[l] = biasPointers.data() + l * layer_weights;
+    }
 
 #ifdef RELOAD_WEIGHT
-    int n = -1; // n=-1 means that we are not saving/loading a head
+    // The container is mapped: the weights are not parsed nor copied (unless it was saved for another layout)
+    WeightContainer container;
+    container.open(weight_file);
 
-    loadWeight(n, 0, NUM_HEAD * D_Q * D_MODEL >> 2, condense_kernel, dir_name);
-    loadWeight(n, 1, D_MODEL * D_FF >> 2, ff0_kernel, dir_name);
-    loadWeight(n, 2, D_MODEL * D_FF >> 2, ff1_kernel, dir_name);
+    // We assign -1 to the layer to indicate that the tensor input is not a weight
+    tensor_in = loadMatrix(config, container, -1, 0, (int) config.seq_len, (int) config.d_model);
+    // The biases are small: they are used straight from the mapping, streamed weights or not
+    for (int l = 0; l < num_layers; l++) {
+        for (int i = 0; i < layer_weights; i++) {
+            if (config.usesWeight(i))
+                biasVecs[l][i] = loadBias(config, container, l, i);
+            has_bias = has_bias || biasVecs[l][i] != nullptr;
+        }
+    }
+#ifdef STREAM_WEIGHTS
+    // A background thread copies the weights of the next layers out of the mapping while the current one runs;
+    // at most resident_layers layers are in memory, the pages of the copied tensors are dropped from the mapping.
+    // The layers are used once, or once per decoded token.
+    std::vector<std::size_t> tensor_words;
+    for (int i = 0; i < layer_weights; i++) {
+        int n_row, n_col;
+        weightShape(config, i, n_row, n_col);
+        tensor_words.push_back(config.usesWeight(i) ? n_row * n_col >> 2 : 0);
+    }
+    WeightStreamer streamer(num_layers, tensor_words, config.resident_layers,
+                            [&config, &container, layer_weights](int layer, uint32_t **weightVector) {
+        for (int i = 0; i < layer_weights; i++) {
+            if (!config.usesWeight(i))
+                continue;
+            int n_row, n_col;
+            weightShape(config, i, n_row, n_col);
+            readMatrix(config, container, layer, i, n_row, n_col, weightVector[i]);
+            container.evict(layer, i);
+        }
+    }, config.decode > 0 ? (long) config.decode : 1);
+    for (int l = 0; l < num_layers; l++) {
+        weightVecs[l] = streamer.weightVector(l);
+    }
 #else
-    fill_weight(condense_kernel, D_MODEL, NUM_HEAD * D_Q >> 2);
-    fill_weight(ff0_kernel, D_MODEL, D_FF >> 2);
-    fill_weight(ff1_kernel, D_FF, D_MODEL >> 2);
-
-    int n = -1; // n=-1 means that we are not saving/loading a head
-    saveWeight(n, 0, NUM_HEAD * D_Q * D_MODEL >> 2, condense_kernel, dir_name);
-    saveWeight(n, 1, D_MODEL* D_FF >> 2, ff0_kernel, dir_name);
-    saveWeight(n, 2, D_MODEL* D_FF >> 2, ff1_kernel, dir_name);
+    for (int l = 0; l < num_layers; l++) {
+        for (int i = 0; i < layer_weights; i++) {
+            if (!config.usesWeight(i))
+                continue;
+            int n_row, n_col;
+            weightShape(config, i, n_row, n_col);
+            weights.push_back(loadMatrix(config, container, l, i, n_row, n_col));
+            // A view of the mapping is not read before the blocks tag it for gem5: its pages are mapped now
+            weights.back().touch();
+            weightVecs[l][i] = weights.back().data();
+        }
+    }
 #endif
+#else
+    WeightContainerWriter writer;
+
+    tensor_in = Tensor(config.seq_len, config.d_model, layout);
+    fill_kernel(tensor_in.data(), (int) tensor_in.words());
+    // We assign -1 to the layer to indicate that the tensor input is not a weight
+    writer.add(-1, 0, tensor_in.data(), (int) config.seq_len, (int) config.d_model, layout, sa_size);
+    for (int l = 0; l < num_layers; l++) {
+        for (int i = 0; i < layer_weights; i++) {
+            if (!config.usesWeight(i))
+                continue; // the heads of a group share the key and value weights of the first one
+            int n_row, n_col;
+            weightShape(config, i, n_row, n_col);
+            weights.push_back(generateMatrix(config, n_row, n_col));
+            weightVecs[l][i] = weights.back().data();
+            writer.add(l, i, weightVecs[l][i], n_row, n_col, layout, sa_size);
+        }
+    }
 
-#ifndef BWMA
-    // By default, the saved weights are in block-wise format
-    // We need to convert them to row-wise format
-    uint32_t* condenseRowWise = new uint32_t [NUM_HEAD * D_Q * D_MODEL >> 2];
-    blockWise2RowWise(condense_kernel, condenseRowWise, NUM_HEAD * D_Q, D_MODEL >> 2);
-    condense_kernel = condenseRowWise;
-    uint32_t* ff0RowWise = new uint32_t [D_MODEL * D_FF >> 2];
-    blockWise2RowWise(ff0_kernel, ff0RowWise, D_MODEL, D_FF >> 2);
-    ff0_kernel = ff0RowWise;
-    uint32_t* ff1RowWise = new uint32_t [D_FF * D_MODEL >> 2];
-    blockWise2RowWise(ff1_kernel, ff1RowWise, D_FF, D_MODEL >> 2);
-    ff1_kernel = ff1RowWise;
+    // Save the weights in the memory arrangement of this run, so that reloading them is zero-copy
+    std::error_code ec; // the weights are simply not saved if the directory cannot be created
+    std::filesystem::create_directories(config.weight_dir, ec);
+    writer.save(weight_file);
 #endif
 
-    weightVec[NUM_HEAD * 3] = condense_kernel;
-    weightVec[NUM_HEAD * 3 + 1] = ff0_kernel;
-    weightVec[NUM_HEAD * 3 + 2] = ff1_kernel;
+#if defined(RELOAD_WEIGHT) && defined(STREAM_WEIGHTS)
+    WeightStreamer *weight_streamer = &streamer;
+#else
+    WeightStreamer *weight_streamer = nullptr;
+#endif
+    // The batch repeats the input sequence
+    Tensor batch_in;
+    if (config.batch > 1) {
+        batch_in = Tensor(config.batch * config.seq_len, config.d_model, layout);
+        for (std::size_t b = 0; b < config.batch; b++) {
+            uint32_t *sequence = batch_in.data() + b * tensor_in.words();
+            std::copy(tensor_in.data(), tensor_in.data() + tensor_in.words(), sequence);
+        }
+    }
+    std::vector<std::size_t> valid_lens(config.batch, config.valid_len);
 
-    TransformerBlock selfatten(D_SEQ, D_MODEL, D_Q, NUM_HEAD, D_FF, weightVec, KERNEL_DIM, MAX_COL);
-    selfatten.compute(D_SEQ, tensor_in, out);
+    TransformerEncoder encoder(config.num_layers, config.seq_len, config.d_model, config.head_size, config.num_heads,
+                               config.ff_size, weightVecs.data(), sa_size, sa_size / 4,
+                               has_bias ? biasVecs.data() : nullptr, weight_streamer,
+                               config.batch, config.decode, config.kv_heads);
+    if (config.decode > 0) {
+        // Autoregressive decoding from the first token of the input: each output is the next input
+        Tensor token(1, config.d_model, layout);
+        Tensor next(1, config.d_model, layout);
+        if (config.kernel.bwma) {
+            Layout::blockWiseResizeRows(tensor_in.data(), config.seq_len, token.data(), 1, config.d_model >> 2,
+                                        sa_size / 4);
+        } else {
+            std::copy(tensor_in.data(), tensor_in.data() + token.words(), token.data());
+        }
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t t = 0; t < config.decode; t++) {
+            if (!encoder.computeStep(token.data(), next.data()))
+                break;
+            std::swap(token, next);
+        }
+        std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+        std::cout << "Decoded " << encoder.contextLength() << " tokens, " << time.count() << " s, "
+                  << (double) encoder.contextLength() / time.count() << " tokens/s" << std::endl;
+    } else {
+        encoder.computeBatch(config.batch, config.seq_len, config.batch > 1 ? batch_in.data() : tensor_in.data(),
+                             out.data(), valid_lens.data());
+    }
+    Roi::report(std::cout);
 }
 
-int main() {
-    test();
+int main(int argc, char **argv) {
+    ModelConfig config;
+    if (!config.parseArgs(argc, argv) || !config.validate())
+        return 1;
+    if (!KernelRegistry::select(config.kernel)) {
+        std::cerr << "The kernels of the configuration are not in this binary (available: "
+                  << KernelRegistry::available() << ")" << std::endl;
+        return 1;
+    }
+    Roi::setDepth(config.roi_depth);
+    OpCounter::setPeaks((double) config.peak_gops, (double) config.peak_gbps);
+    if (!config.sa_trace.empty() &&
+        !SaTrace::open(config.sa_trace, config.kernel.sa_size, config.kernel.core_num))
+        return 1;
+    if (!config.sa_timeline.empty() && !SaTimeline::open(config.sa_timeline))
+        return 1;
+    test(config);
+    SaTrace::close();
+    SaTimeline::close();
     return 0;
-}
\ No newline at end of file
+}
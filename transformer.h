@@ -10,5 +10,8 @@
 #define D_MODEL 768
 #define NUM_HEAD 12
 #define D_FF 3072
+#define NUM_LAYERS 12
+// Layers whose weights are in memory at the same time with -DSTREAM_WEIGHTS
+#define RESIDENT_LAYERS 2
 
 #endif //FVLLMONTITRANSFORMER_TRANSFORMER_H
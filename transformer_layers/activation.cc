@@ -0,0 +1,47 @@
+#include "activation.h"
+#include <cmath>
+#include <algorithm>
+
+// We assume that the values are fixed-point with 2 bits of fraction, as in Softmax and AddNormalize.
+#define ACT_FRACTION_BITS 2
+
+struct ActivationTables {
+    int8_t relu[256];
+    int8_t gelu[256];
+
+    ActivationTables() {
+        for (int i = 0; i < 256; i++) {
+            auto q = (int8_t) i;
+            relu[i] = (int8_t) (q > 0 ? q : 0);
+
+            double x = (double) q / (1 << ACT_FRACTION_BITS);
+            double y = 0.5 * x * (1.0 + std::erf(x / std::sqrt(2.0)));
+            auto result = (int32_t) std::lround(y * (1 << ACT_FRACTION_BITS));
+            gelu[i] = (int8_t) std::max(-128, std::min(127, result));
+        }
+    }
+};
+
+static const ActivationTables tables;
+
+const int8_t* Activation::lookup(ActivationType type) {
+    switch (type) {
+        case ACT_RELU:
+            return tables.relu;
+        case ACT_GELU:
+            return tables.gelu;
+        default:
+            return nullptr;
+    }
+}
+
+void Activation::compute(uint32_t* input, std::size_t size, ActivationType type) {
+    const int8_t* lut = lookup(type);
+    if (lut == nullptr)
+        return;
+    auto* input_ptr = (uint8_t*) input;
+    for (std::size_t i = 0; i < size; i++) {
+        *input_ptr = (uint8_t) lut[*input_ptr];
+        input_ptr++;
+    }
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "util.h"
+
+enum ActivationType {
+    ACT_NONE,
+    ACT_RELU,
+    ACT_GELU,
+};
+
+class Activation {
+public:
+    // Returns the 256-entry int8 -> int8 lookup table of the activation (indexed by the uint8_t bit pattern),
+    // or nullptr for ACT_NONE. The tables are meant to be fused into the GEMM epilogue.
+    static const int8_t* lookup(ActivationType type);
+    static void compute(uint32_t* input, std::size_t size, ActivationType type);
+};
@@ -0,0 +1,89 @@
+//
+// Activation memory planner, see activationArena.h
+//
+
+#include "activationArena.h"
+#include "roi.h"
+#include <algorithm>
+#include <iostream>
+
+ActivationArena::ActivationArena() {
+    size_ = 0;
+}
+
+ActivationArena::~ActivationArena() = default;
+
+int ActivationArena::addTensor(std::size_t words, int first_use, int last_use, const char *name) {
+    if (storage_.owner()) {
+        std::cerr << "ActivationArena: tensor added after planning" << std::endl;
+        return -1;
+    }
+    std::size_t bytes = (words * sizeof(uint32_t) + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+    tensors_.push_back({bytes, first_use, last_use, 0, name, {}});
+    return (int) tensors_.size() - 1;
+}
+
+void ActivationArena::plan() {
+    // Greedy first-fit by decreasing size: each tensor takes the lowest offset that does not collide with an
+    // already placed tensor whose lifetime overlaps its own.
+    std::vector<int> order(tensors_.size());
+    for (std::size_t i = 0; i < order.size(); i++)
+        order[i] = (int) i;
+    std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+        return tensors_[a].bytes > tensors_[b].bytes;
+    });
+
+    std::vector<int> placed;
+    for (int id : order) {
+        TensorLifetime &tensor = tensors_[id];
+        std::vector<const TensorLifetime*> live;
+        for (int other : placed) {
+            const TensorLifetime &o = tensors_[other];
+            if (o.first_use <= tensor.last_use && tensor.first_use <= o.last_use)
+                live.push_back(&o);
+        }
+        std::sort(live.begin(), live.end(), [](const TensorLifetime *a, const TensorLifetime *b) {
+            return a->offset < b->offset;
+        });
+
+        std::size_t offset = 0;
+        for (const TensorLifetime *o : live) {
+            if (offset + tensor.bytes <= o->offset)
+                break;
+            offset = std::max(offset, o->offset + o->bytes);
+        }
+        tensor.offset = offset;
+        size_ = std::max(size_, offset + tensor.bytes);
+        placed.push_back(id);
+    }
+
+    // The tensors sharing memory take its tag from each other (see get())
+    for (std::size_t a = 0; a < tensors_.size(); a++) {
+        TensorLifetime &t = tensors_[a];
+        t.shared.clear();
+        for (std::size_t b = 0; b < tensors_.size(); b++) {
+            const TensorLifetime &o = tensors_[b];
+            if (a != b && o.offset < t.offset + t.bytes && t.offset < o.offset + o.bytes)
+                t.shared.push_back((int) b);
+        }
+    }
+    tagged_.assign(tensors_.size(), false);
+
+    storage_ = Tensor(1, size_, LAYOUT_RWMA, size_ >= TENSOR_HUGEPAGE_SIZE ? MEMORY_HUGEPAGE : MEMORY_ALIGNED);
+}
+
+uint32_t* ActivationArena::get(int id) const {
+    uint32_t *data = (uint32_t*) ((uint8_t*) storage_.data() + tensors_[id].offset);
+    if (!tagged_[id]) {
+        Roi::tagTensor(tensors_[id].name, data, tensors_[id].bytes);
+        tagged_[id] = true;
+        for (int other : tensors_[id].shared) {
+            tagged_[other] = false;
+        }
+    }
+    return data;
+}
+
+std::size_t ActivationArena::size() const {
+    return size_;
+}
@@ -0,0 +1,46 @@
+//
+// Activation memory planner: every tensor is registered with the first and last step in which it is used, then
+// plan() assigns offsets in a single aligned region so that tensors with disjoint lifetimes share memory.
+//
+
+#ifndef FVLLMONTITRANSFORMER_ACTIVATIONARENA_H
+#define FVLLMONTITRANSFORMER_ACTIVATIONARENA_H
+
+#include "tensor.h"
+
+#define ARENA_ALIGNMENT 64
+
+class ActivationArena {
+public:
+    ActivationArena();
+    ~ActivationArena();
+
+    // Registers a tensor of `words` uint32_t live from step first_use to step last_use (inclusive) and returns its id.
+    // Its memory traffic is counted under its name in gem5 (see Roi::tagTensor).
+    int addTensor(std::size_t words, int first_use, int last_use, const char *name = "activations");
+    // Assigns the offsets and allocates the scratch region (on hugepages if it is large enough). No tensor may be
+    // added afterwards.
+    void plan();
+    // The memory of a tensor. It is tagged with the name of the tensor the first time, and again only if a tensor
+    // sharing the memory has tagged it since (the tags are m5 operations, which the regions of interest would count).
+    uint32_t* get(int id) const;
+    // Size of the scratch region in bytes (peak activation memory)
+    std::size_t size() const;
+
+private:
+    struct TensorLifetime {
+        std::size_t bytes;
+        int first_use;
+        int last_use;
+        std::size_t offset;
+        const char *name;
+        std::vector<int> shared; // the tensors whose memory overlaps this one
+    };
+
+    std::vector<TensorLifetime> tensors_;
+    mutable std::vector<bool> tagged_; // the memory of the tensor is tagged with its name
+    Tensor storage_;
+    std::size_t size_;
+};
+
+#endif //FVLLMONTITRANSFORMER_ACTIVATIONARENA_H
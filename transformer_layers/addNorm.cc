@@ -3,18 +3,33 @@
 //
 
 #include "addNorm.h"
+#include "opCounter.h"
 #include <cmath>
+#include <cstring>
 
-AddNormalize::AddNormalize(std::size_t seq_len, std::size_t input_dim,
+AddNormalize::AddNormalize(std::size_t pre_seq_len, std::size_t input_dim,
                            std::size_t kernelDim, std::size_t maxCol) {
+    // The sequence length is given to compute(): pre_seq_len only bounds it
     input_dim_ = input_dim;
-    seq_len_ = seq_len;
     kernel_dim_ = kernelDim;
     max_col_ = maxCol;
 }
 
-void AddNormalize::compute(uint32_t *input, uint32_t *output) {
-    for (int i =0; i< seq_len_; i++){
+// A valid row is read three times and written twice (addition, mean and variance, normalization), with about five
+// operations per element; the padded rows are cleared
+static OpCounts addNormCounts(std::size_t seq_len, std::size_t valid_len, std::size_t input_dim) {
+    OpCounts counts{};
+    counts.ops = 5 * (uint64_t) valid_len * input_dim;
+    counts.bytes_read = 4 * (uint64_t) valid_len * input_dim;
+    counts.bytes_written = (uint64_t) (valid_len + seq_len) * input_dim;
+    return counts;
+}
+
+void AddNormalize::compute(std::size_t seq_len, uint32_t *input, uint32_t *output, std::size_t valid_len) {
+    valid_len = valid_len ? valid_len : seq_len;
+    OpCounter::Section section(OP_ADDNORM, addNormCounts(seq_len, valid_len, input_dim_));
+    memset(output + valid_len * (input_dim_ >> 2), 0, (seq_len - valid_len) * input_dim_);
+    for (std::size_t i =0; i< valid_len; i++){
         auto* input_ptr = (int8_t*) (input + i * (input_dim_ >> 2));
         auto* output_ptr = (int8_t*) (output + i * (input_dim_ >> 2));
         int32_t sum = 0;
@@ -45,23 +60,30 @@ void AddNormalize::compute(uint32_t *input, uint32_t *output) {
 }
 
 
-void AddNormalize::computeRearranged(uint32_t *input, uint32_t *output) {
-    auto* input_ptr = (int8_t*) (input );
-    auto* output_ptr = (int8_t*) (output);
-    for (int i =0; i< seq_len_* input_dim_; i++){
-        *output_ptr = (int8_t) (*output_ptr + *input_ptr);
-        output_ptr ++;
-        input_ptr ++;
+void AddNormalize::computeRearranged(std::size_t seq_len, uint32_t *input, uint32_t *output, std::size_t valid_len) {
+    valid_len = valid_len ? valid_len : seq_len;
+    OpCounter::Section section(OP_ADDNORM, addNormCounts(seq_len, valid_len, input_dim_));
+    // The rows of a column block are contiguous: add the valid ones and clear the padded ones
+    for (std::size_t j =0; j< input_dim_ / kernel_dim_; j++){
+        auto* input_ptr = ((int8_t*) input) + j * seq_len * kernel_dim_;
+        auto* output_ptr = ((int8_t*) output) + j * seq_len * kernel_dim_;
+        for (std::size_t i =0; i< valid_len * kernel_dim_; i++){
+            *output_ptr = (int8_t) (*output_ptr + *input_ptr);
+            output_ptr ++;
+            input_ptr ++;
+        }
+        memset(output_ptr, 0, (seq_len - valid_len) * kernel_dim_);
     }
 
-    for (int i=0; i< seq_len_; i++){
+    int8_t* output_ptr;
+    for (std::size_t i=0; i< valid_len; i++){
         output_ptr = ((int8_t*) output) + i*kernel_dim_;
         int sum = 0;
         for (int j =0; j< input_dim_ / kernel_dim_; j++){
             for (int k=0; k< kernel_dim_; k++) {
                 sum += *(output_ptr+k);
             }
-            output_ptr += seq_len_* kernel_dim_;
+            output_ptr += seq_len* kernel_dim_;
         }
 
         auto mean = (int32_t) (sum / input_dim_);
@@ -71,7 +93,7 @@ void AddNormalize::computeRearranged(uint32_t *input, uint32_t *output) {
             for (int k=0; k< kernel_dim_; k++) {
                 variance+= (*(output_ptr+k) - mean) ^ 2; // Assuming that the values are fixed-point with 2 digit of fraction.
             }
-            output_ptr += seq_len_* kernel_dim_;
+            output_ptr += seq_len* kernel_dim_;
         }
 
         variance = variance / (int) input_dim_;
@@ -83,7 +105,7 @@ void AddNormalize::computeRearranged(uint32_t *input, uint32_t *output) {
             for (int k=0; k< kernel_dim_; k++) {
                 *(output_ptr+k) = (int8_t) ((*(output_ptr+k) - mean) * (sd_inv) >> 2);
             }
-            output_ptr += seq_len_* kernel_dim_;
+            output_ptr += seq_len* kernel_dim_;
         }
     }
 }
\ No newline at end of file
@@ -9,10 +9,10 @@
 class AddNormalize{
 public:
     AddNormalize(std::size_t, std::size_t, std::size_t, std::size_t);
-    void compute(uint32_t *input, uint32_t *output);
-    void computeRearranged(uint32_t *input, uint32_t *output);
+    // The rows past valid_len (0: seq_len) are padding: they are not normalized and are set to 0
+    void compute(std::size_t seq_len, uint32_t *input, uint32_t *output, std::size_t valid_len = 0);
+    void computeRearranged(std::size_t seq_len, uint32_t *input, uint32_t *output, std::size_t valid_len = 0);
 private:
-    std::size_t seq_len_;
     std::size_t input_dim_;
     std::size_t kernel_dim_;
     std::size_t max_col_;
@@ -4,6 +4,7 @@
 #define MAX_COL (SA_SIZE/4)
 
 #include "debuggerFunctions.h"
+#include "layout.h"
 
 void print_weight(uint32_t* kernel, int n_row, int n_col){
     for (int i=0; i< n_row; i++){
@@ -48,31 +49,11 @@ void read_weight_from_file(const std::string& filename, uint32_t* kernel, int n_
 
 
 void blockWise2RowWise(const uint32_t * blockWise, uint32_t* rowWise, int n_row, int n_col){
-    uint32_t* initialRowWise = rowWise;
-    for (int col=0; col<n_col/MAX_COL; col++){
-        rowWise = initialRowWise + col * MAX_COL;
-        for (int row=0; row < n_row; row++){
-            for (int i=0; i<MAX_COL; i++){
-                *(rowWise + i) = *(blockWise+ i);
-            }
-            blockWise += MAX_COL;
-            rowWise += n_col;
-        }
-    }
+    Layout::blockWiseToRowWise(blockWise, rowWise, n_row, n_col, MAX_COL);
 }
 
 void rowWise2BlockWise(const uint32_t* rowWise, uint32_t* blockWise, int n_row, int n_col) {
-    const uint32_t* initialRowWise = rowWise;
-    for (int col = 0; col < n_col / MAX_COL; col++) {
-        rowWise = initialRowWise + col * MAX_COL;
-        for (int row = 0; row < n_row; row++) {
-            for (int i = 0; i < MAX_COL; i++) {
-                *(blockWise + i) = *(rowWise + i);
-            }
-            rowWise += n_col;
-            blockWise += MAX_COL;
-        }
-    }
+    Layout::rowWiseToBlockWise(rowWise, blockWise, n_row, n_col, MAX_COL);
 }
 
 
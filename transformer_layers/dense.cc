@@ -1,14 +1,17 @@
 #include "dense.h"
+#include "opCounter.h"
 #include <exception>
 //#include <mkl.h>
 #include <memory.h>
 #include <iostream>
 
-Dense::Dense(std::size_t input_size, std::size_t output_size, uint32_t *weightDense) {
+Dense::Dense(std::size_t input_size, std::size_t output_size, uint32_t *weightDense, ActivationType activation,
+             int32_t *biasDense) {
     input_size_ = input_size;
     output_size_ = output_size;
     weight = weightDense;
-    bias = nullptr;
+    bias = biasDense;
+    activation_lut = Activation::lookup(activation);
 }
 
 Dense::~Dense() {
@@ -16,38 +19,22 @@ Dense::~Dense() {
 //    delete[] bias;
 }
 
-void Dense::multiplyweight(std::size_t seq_len, uint32_t *input, uint32_t *output) {
-#ifdef BWMA
-#ifdef SIMD
-    simdComputeBWMA(seq_len, input, output, weight, input_size_, output_size_);
-#else
-    smmComputeBWMA(seq_len, input, output, weight, input_size_, output_size_);
-#endif
-#else
-#ifdef SIMD
-    simdComputeRWMA(seq_len, input, output, weight, input_size_, output_size_);
-#else
-    smmComputeRWMA(seq_len, input, output, weight, input_size_, output_size_);
-#endif
-#endif
-}
-
-void Dense::addbias(std::size_t seq_len, uint32_t *output) {
-
-    for (std::size_t idx = 0; idx < seq_len; idx++) {
-        for (std::size_t feature_idx = 0; feature_idx < output_size_; feature_idx++) {
-            output[idx * output_size_ + feature_idx] += bias[feature_idx];
-        }
+void Dense::multiplyweight(std::size_t seq_len, uint32_t *input, uint32_t *output, std::size_t batch) {
+    if (KernelRegistry::config().bwma) {
+        KernelRegistry::computeBWMA(seq_len, input, output, weight, input_size_, output_size_, bias, activation_lut,
+                                    batch);
+    } else {
+        // The row-wise sequences of the batch are the rows of one matrix
+        KernelRegistry::computeRWMA(batch * seq_len, input, output, weight, input_size_, output_size_, 0, bias,
+                                    activation_lut);
     }
 }
 
-void Dense::compute(std::size_t seq_len, uint32_t *input, uint32_t *output) {
-    // input shape [batch_size, input_size_]
-    // output shape [batch_size, output_size_]
+void Dense::compute(std::size_t seq_len, uint32_t *input, uint32_t *output, std::size_t batch) {
+    // input shape [batch, seq_len, input_size_]
+    // output shape [batch, seq_len, output_size_]
 
-    multiplyweight(seq_len, input, output);
-    // add bias vector here
-    if (bias != nullptr) {
-        addbias(seq_len, output);
-    }
+    // The bias and the activation are applied by the GEMM epilogue
+    OpCounter::Section section(OP_DENSE, OpCounter::gemm(batch * seq_len, input_size_, output_size_));
+    multiplyweight(seq_len, input, output, batch);
 }
@@ -5,23 +5,26 @@
 // #include <unordered_map>
 // #include <string>
 #include "util.h"
-#include "../accelerator/smm_gem.h"
+#include "activation.h"
+#include "../accelerator/kernel_registry.h"
 
 class Dense {
 public:
-    Dense(std::size_t input_dim, std::size_t output_dim, uint32_t *weight);
+    Dense(std::size_t input_dim, std::size_t output_dim, uint32_t *weight, ActivationType activation = ACT_NONE,
+          int32_t *bias = nullptr);
 
     ~Dense();
 
-    void compute(std::size_t seq_len, uint32_t *input, uint32_t *output);
+    // input and output hold batch sequences of seq_len rows one after the other, in the memory arrangement of the
+    // kernels; the weights are loaded once for the whole batch
+    void compute(std::size_t seq_len, uint32_t *input, uint32_t *output, std::size_t batch = 1);
 
 private:
-    void multiplyweight(std::size_t seq_len, uint32_t *input, uint32_t *output);
-
-    void addbias(std::size_t seq_len, uint32_t *output);
+    void multiplyweight(std::size_t seq_len, uint32_t *input, uint32_t *output, std::size_t batch);
 
     std::size_t input_size_;
     std::size_t output_size_;
     uint32_t *weight; // shape [input_size_, output_size_]
-    uint32_t *bias;   // shape [output_size_]
+    int32_t *bias;    // shape [output_size_], fused into the GEMM epilogue, nullptr if no bias
+    const int8_t *activation_lut; // fused into the GEMM epilogue, nullptr if no activation
 };
\ No newline at end of file
@@ -0,0 +1,66 @@
+//
+// KV cache of an attention head, see kvCache.h
+//
+
+#include "kvCache.h"
+#include "roi.h"
+#include <algorithm>
+
+KVCache::KVCache(std::size_t max_context, std::size_t head_size, std::size_t kernelDim)
+        : head_size_(head_size), kernel_dim_(kernelDim), max_col_(kernelDim >> 2),
+          max_context_((max_context + kernelDim - 1) / kernelDim * kernelDim), length_(0),
+          keys_(head_size, max_context_, LAYOUT_BWMA), values_(max_context_, head_size, LAYOUT_BWMA) {
+    Roi::tagTensor("kv_cache", keys_.data(), keys_.bytes());
+    Roi::tagTensor("kv_cache", values_.data(), values_.bytes());
+}
+
+bool KVCache::append(const uint32_t *key, const uint32_t *value) {
+    if (length_ == max_context_)
+        return false;
+    std::size_t position = length_;
+
+    // Column `position` of the transposed keys. As in Layout::rowWiseToTransposed, element h of the key goes to row
+    // 4 * (h / 4) + 3 - h % 4 of the transpose, and the positions are in the reverse order within the words.
+    uint32_t *block = keys_.data() + (position / kernel_dim_) * head_size_ * max_col_;
+    std::size_t word = (position % kernel_dim_) >> 2;
+    int shift = 8 * (3 - (int) (position & 3));
+    auto *key_bytes = (const uint8_t *) key;
+    for (std::size_t h = 0; h < head_size_; h++) {
+        std::size_t row = (h & ~(std::size_t) 3) + 3 - (h & 3);
+        uint32_t &target = block[row * max_col_ + word];
+        target = (target & ~(0xFFu << shift)) | ((uint32_t) key_bytes[h] << shift);
+    }
+
+    // Row `position` of every column block of the values
+    for (std::size_t j = 0; j < head_size_ / kernel_dim_; j++) {
+        std::copy(value + j * max_col_, value + (j + 1) * max_col_,
+                  values_.data() + (j * max_context_ + position) * max_col_);
+    }
+
+    length_++;
+    return true;
+}
+
+void KVCache::clear() {
+    length_ = 0;
+}
+
+std::size_t KVCache::length() const {
+    return length_;
+}
+
+std::size_t KVCache::paddedLength() const {
+    return (length_ + kernel_dim_ - 1) / kernel_dim_ * kernel_dim_;
+}
+
+std::size_t KVCache::maxContext() const {
+    return max_context_;
+}
+
+uint32_t *KVCache::keys() const {
+    return keys_.data();
+}
+
+uint32_t *KVCache::values(std::size_t block) const {
+    return values_.data() + block * max_context_ * max_col_;
+}
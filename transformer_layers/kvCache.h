@@ -0,0 +1,47 @@
+//
+// Keys and values of the previous tokens of an attention head, for decoding one token at a time. They are kept in
+// the block-wise arrangement of the weights of the SA GEMMs (see smmComputeBWMA), so that the attention of a new
+// token runs on them without any conversion:
+//  - the keys, transposed ([head_size, max_context], in the byte order of Transpose): the column blocks of the
+//    positions follow each other, so the scores of the first positions are a GEMM on the first blocks,
+//  - the values ([max_context, head_size]): each column block holds the rows of all the positions.
+//
+
+#ifndef FVLLMONTITRANSFORMER_KVCACHE_H
+#define FVLLMONTITRANSFORMER_KVCACHE_H
+
+#include "tensor.h"
+
+class KVCache {
+public:
+    // max_context is rounded up to the SA tiles (kernelDim)
+    KVCache(std::size_t max_context, std::size_t head_size, std::size_t kernelDim);
+
+    // Appends the key and the value (one row of head_size int8 each) of the next position. Returns false if the
+    // cache is full.
+    bool append(const uint32_t *key, const uint32_t *value);
+    // Forgets all the positions (the memory is reused as is: the positions past length() are always masked)
+    void clear();
+
+    // Positions in the cache
+    std::size_t length() const;
+    // length() rounded up to the SA tiles: the positions covered by the GEMMs of the attention
+    std::size_t paddedLength() const;
+    std::size_t maxContext() const;
+
+    // Weights of the [head_size, paddedLength()] GEMM of the scores
+    uint32_t *keys() const;
+    // Weights of the [paddedLength(), kernelDim] GEMM of the column block of the values
+    uint32_t *values(std::size_t block) const;
+
+private:
+    std::size_t head_size_;
+    std::size_t kernel_dim_;
+    std::size_t max_col_;
+    std::size_t max_context_;
+    std::size_t length_;
+    Tensor keys_;
+    Tensor values_;
+};
+
+#endif //FVLLMONTITRANSFORMER_KVCACHE_H
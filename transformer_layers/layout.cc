@@ -0,0 +1,152 @@
+//
+// Memory arrangement conversions, see layout.h
+//
+
+#include "layout.h"
+#include <algorithm>
+
+// Rows converted together: the panel of the row-wise matrix stays in the cache while it is split into the blocks
+#define LAYOUT_PANEL_ROWS 64
+// Tiles of 4x4 words transposed together in rowWiseToTransposed
+#define LAYOUT_TRANSPOSE_TILES 8
+
+static inline void copyWords(const uint32_t *src, uint32_t *dst, std::size_t n) {
+#pragma omp simd
+    for (std::size_t i = 0; i < n; i++) {
+        dst[i] = src[i];
+    }
+}
+
+// 4x4 int8 transpose of four words read with the given stride, in the byte order of Transpose: byte k (from the
+// most significant one) of output word s is byte s of input word k. The 16-bit halves are exchanged first, then
+// the bytes, with masks instead of a loop over the bytes.
+static inline void transpose4x4(const uint32_t *in, std::size_t in_stride, uint32_t *out, std::size_t out_stride) {
+    uint32_t a = in[0], b = in[in_stride], c = in[2 * in_stride], d = in[3 * in_stride];
+    uint32_t t0 = (a & 0xFFFF0000u) | (c >> 16);
+    uint32_t t1 = (b & 0xFFFF0000u) | (d >> 16);
+    uint32_t t2 = (a << 16) | (c & 0x0000FFFFu);
+    uint32_t t3 = (b << 16) | (d & 0x0000FFFFu);
+    out[0] = (t0 & 0xFF00FF00u) | ((t1 >> 8) & 0x00FF00FFu);
+    out[out_stride] = ((t0 << 8) & 0xFF00FF00u) | (t1 & 0x00FF00FFu);
+    out[2 * out_stride] = (t2 & 0xFF00FF00u) | ((t3 >> 8) & 0x00FF00FFu);
+    out[3 * out_stride] = ((t2 << 8) & 0xFF00FF00u) | (t3 & 0x00FF00FFu);
+}
+
+// Moves the chunks (of chunk words) of a rows x cols matrix of chunks to the transposed position, following the
+// cycles of the permutation
+static void transposeChunks(uint32_t *data, std::size_t rows, std::size_t cols, std::size_t chunk) {
+    std::size_t n = rows * cols;
+    std::vector<bool> moved(n, false);
+    std::vector<uint32_t> carry(chunk), swap(chunk);
+    // The first and the last chunks never move
+    for (std::size_t start = 1; start + 1 < n; start++) {
+        if (moved[start])
+            continue;
+        copyWords(data + start * chunk, carry.data(), chunk);
+        std::size_t k = start;
+        do {
+            // The chunk (k / cols, k % cols) goes to (k % cols, k / cols) of the cols x rows matrix
+            std::size_t next = (k % cols) * rows + k / cols;
+            copyWords(data + next * chunk, swap.data(), chunk);
+            copyWords(carry.data(), data + next * chunk, chunk);
+            std::swap(carry, swap);
+            moved[next] = true;
+            k = next;
+        } while (k != start);
+    }
+}
+
+void Layout::rowWiseToBlockWise(const uint32_t *rowWise, uint32_t *blockWise, std::size_t n_row,
+                                std::size_t n_col, std::size_t maxCol) {
+    int n_panels = (int) ((n_row + LAYOUT_PANEL_ROWS - 1) / LAYOUT_PANEL_ROWS);
+#pragma omp parallel for
+    for (int panel = 0; panel < n_panels; panel++) {
+        std::size_t first_row = panel * LAYOUT_PANEL_ROWS;
+        std::size_t rows = std::min((std::size_t) LAYOUT_PANEL_ROWS, n_row - first_row);
+        // Each block of the panel is written contiguously
+        for (std::size_t block = 0; block < n_col / maxCol; block++) {
+            const uint32_t *src = rowWise + first_row * n_col + block * maxCol;
+            uint32_t *dst = blockWise + (block * n_row + first_row) * maxCol;
+            for (std::size_t row = 0; row < rows; row++) {
+                copyWords(src + row * n_col, dst + row * maxCol, maxCol);
+            }
+        }
+    }
+}
+
+void Layout::blockWiseToRowWise(const uint32_t *blockWise, uint32_t *rowWise, std::size_t n_row,
+                                std::size_t n_col, std::size_t maxCol) {
+    int n_panels = (int) ((n_row + LAYOUT_PANEL_ROWS - 1) / LAYOUT_PANEL_ROWS);
+#pragma omp parallel for
+    for (int panel = 0; panel < n_panels; panel++) {
+        std::size_t first_row = panel * LAYOUT_PANEL_ROWS;
+        std::size_t rows = std::min((std::size_t) LAYOUT_PANEL_ROWS, n_row - first_row);
+        for (std::size_t block = 0; block < n_col / maxCol; block++) {
+            const uint32_t *src = blockWise + (block * n_row + first_row) * maxCol;
+            uint32_t *dst = rowWise + first_row * n_col + block * maxCol;
+            for (std::size_t row = 0; row < rows; row++) {
+                copyWords(src + row * maxCol, dst + row * n_col, maxCol);
+            }
+        }
+    }
+}
+
+void Layout::blockWiseResizeRows(const uint32_t *input, std::size_t in_rows, uint32_t *output,
+                                 std::size_t out_rows, std::size_t n_col, std::size_t maxCol) {
+    std::size_t rows = std::min(in_rows, out_rows);
+    int n_blocks = (int) (n_col / maxCol);
+#pragma omp parallel for
+    for (int block = 0; block < n_blocks; block++) {
+        uint32_t *dst = output + block * out_rows * maxCol;
+        copyWords(input + block * in_rows * maxCol, dst, rows * maxCol);
+        std::fill(dst + rows * maxCol, dst + out_rows * maxCol, 0);
+    }
+}
+
+void Layout::rowWiseToBlockWiseInPlace(uint32_t *data, std::size_t n_row, std::size_t n_col, std::size_t maxCol) {
+    // Row-wise is a n_row x (n_col / maxCol) matrix of blocks, block-wise is its transpose
+    transposeChunks(data, n_row, n_col / maxCol, maxCol);
+}
+
+void Layout::blockWiseToRowWiseInPlace(uint32_t *data, std::size_t n_row, std::size_t n_col, std::size_t maxCol) {
+    transposeChunks(data, n_col / maxCol, n_row, maxCol);
+}
+
+void Layout::rowWiseToTransposed(const uint32_t *input, uint32_t *output, std::size_t width, std::size_t height) {
+    std::size_t height_tile = height >> 2;
+    std::size_t width_tile = width >> 2;
+    int n_tile_rows = (int) ((height_tile + LAYOUT_TRANSPOSE_TILES - 1) / LAYOUT_TRANSPOSE_TILES);
+#pragma omp parallel for
+    for (int ti = 0; ti < n_tile_rows; ti++) {
+        std::size_t i_end = std::min(height_tile, (std::size_t) (ti + 1) * LAYOUT_TRANSPOSE_TILES);
+        for (std::size_t tj = 0; tj < width_tile; tj += LAYOUT_TRANSPOSE_TILES) {
+            std::size_t j_end = std::min(width_tile, tj + LAYOUT_TRANSPOSE_TILES);
+            for (std::size_t i = ti * LAYOUT_TRANSPOSE_TILES; i < i_end; i++) {
+                for (std::size_t j = tj; j < j_end; j++) {
+                    transpose4x4(input + i * 4 * width_tile + j, width_tile,
+                                 output + j * 4 * height_tile + i, height_tile);
+                }
+            }
+        }
+    }
+}
+
+void Layout::blockWiseToTransposed(const uint32_t *input, uint32_t *output, std::size_t width, std::size_t height,
+                                   std::size_t kernelSize) {
+    std::size_t maxCol = kernelSize >> 2;
+    int tileRow = (int) (height / kernelSize);
+    int tileCol = (int) (width / kernelSize);
+#pragma omp parallel for collapse(2)
+    for (int i = 0; i < tileRow; i++) {
+        for (int j = 0; j < tileCol; j++) {
+            const uint32_t *tileInputPtr = input + (j * tileRow + i) * (kernelSize * maxCol);
+            uint32_t *tileOutputPtr = output + (i * tileCol + j) * (kernelSize * maxCol);
+            for (std::size_t m = 0; m < maxCol; m++) {
+                for (std::size_t k = 0; k < maxCol; k++) {
+                    transpose4x4(tileInputPtr + 4 * k * maxCol + m, maxCol,
+                                 tileOutputPtr + 4 * m * maxCol + k, maxCol);
+                }
+            }
+        }
+    }
+}
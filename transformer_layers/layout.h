@@ -0,0 +1,40 @@
+//
+// Conversions between the memory arrangements of the matrices, for any tile size:
+//  - row-wise (RWMA): the rows one after the other,
+//  - block-wise (BWMA): column blocks of maxCol words (kernelSize = 4 * maxCol int8 columns), one after the other,
+//    each one holding all the rows,
+//  - transposed: the transpose of the matrix, in the byte order of Transpose.
+// The sizes are in uint32_t words for the columns and in rows for the rows, as in the rest of the layers.
+// The out-of-place conversions are cache-blocked and split across the OpenMP threads.
+//
+
+#ifndef FVLLMONTITRANSFORMER_LAYOUT_H
+#define FVLLMONTITRANSFORMER_LAYOUT_H
+
+#include "util.h"
+
+class Layout {
+public:
+    static void rowWiseToBlockWise(const uint32_t* rowWise, uint32_t* blockWise, std::size_t n_row,
+                                   std::size_t n_col, std::size_t maxCol);
+    static void blockWiseToRowWise(const uint32_t* blockWise, uint32_t* rowWise, std::size_t n_row,
+                                   std::size_t n_col, std::size_t maxCol);
+
+    // Block-wise matrix of in_rows rows to the block-wise matrix of its first out_rows rows (the rows past in_rows
+    // are 0), e.g. to drop the padding rows of a sequence
+    static void blockWiseResizeRows(const uint32_t* input, std::size_t in_rows, uint32_t* output,
+                                    std::size_t out_rows, std::size_t n_col, std::size_t maxCol);
+
+    // In place: the blocks of maxCol words are moved along the cycles of the permutation (one bit per block and
+    // two blocks of extra memory). This is not parallel.
+    static void rowWiseToBlockWiseInPlace(uint32_t* data, std::size_t n_row, std::size_t n_col, std::size_t maxCol);
+    static void blockWiseToRowWiseInPlace(uint32_t* data, std::size_t n_row, std::size_t n_col, std::size_t maxCol);
+
+    // width (int8 columns) x height (rows) row-wise matrix to its row-wise transpose
+    static void rowWiseToTransposed(const uint32_t* input, uint32_t* output, std::size_t width, std::size_t height);
+    // width (int8 columns) x height (rows) block-wise matrix to its block-wise transpose, with the same tile size
+    static void blockWiseToTransposed(const uint32_t* input, uint32_t* output, std::size_t width,
+                                      std::size_t height, std::size_t kernelSize);
+};
+
+#endif //FVLLMONTITRANSFORMER_LAYOUT_H
@@ -0,0 +1,215 @@
+//
+// Runtime configuration of the model and of the kernels, see modelConfig.h
+//
+
+#include "modelConfig.h"
+#include "../transformer.h"
+#include "../accelerator/smm_gem.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+ModelConfig::ModelConfig() {
+    seq_len = D_SEQ;
+    valid_len = 0;
+    batch = 1;
+    decode = 0;
+    d_model = D_MODEL;
+    num_heads = NUM_HEAD;
+    kv_heads = 0;
+    head_size = D_Q;
+    ff_size = D_FF;
+    num_layers = NUM_LAYERS;
+    resident_layers = RESIDENT_LAYERS;
+    weight_dir = "/path/to/weight/directory";
+    kernel = KernelRegistry::defaultConfig();
+    roi_depth = 2;
+    peak_gops = 0;
+    peak_gbps = 0;
+}
+
+static std::string trim(const std::string &text) {
+    std::size_t begin = text.find_first_not_of(" \t\r");
+    std::size_t end = text.find_last_not_of(" \t\r");
+    return begin == std::string::npos ? "" : text.substr(begin, end - begin + 1);
+}
+
+bool ModelConfig::parseFile(const std::string &filename) {
+    std::ifstream file(filename);
+    if (!file) {
+        std::cerr << "Error opening config file: " << filename << std::endl;
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty())
+            continue;
+        std::size_t equal = line.find('=');
+        if (equal == std::string::npos || !set(trim(line.substr(0, equal)), trim(line.substr(equal + 1)))) {
+            std::cerr << "Invalid line in " << filename << ": " << line << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ModelConfig::parseArgs(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 2, "--") != 0) {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return false;
+        }
+        std::string key = arg.substr(2);
+        std::string value;
+        std::size_t equal = key.find('=');
+        if (equal != std::string::npos) {
+            value = key.substr(equal + 1);
+            key = key.substr(0, equal);
+        } else if (i + 1 < argc) {
+            value = argv[++i];
+        } else {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return false;
+        }
+        std::replace(key.begin(), key.end(), '-', '_');
+
+        bool valid = (key == "config") ? parseFile(value) : set(key, value);
+        if (!valid) {
+            std::cerr << "Invalid argument: " << arg << " " << value << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ModelConfig::set(const std::string &key, const std::string &value) {
+    std::size_t number = 0;
+    if (key != "weight_dir" && key != "backend" && key != "layout" && key != "sa_trace" &&
+        key != "sa_timeline") {
+        try {
+            number = std::stoul(value);
+        } catch (const std::exception &) {
+            return false;
+        }
+    }
+
+    if (key == "seq_len") {
+        seq_len = number;
+    } else if (key == "valid_len") {
+        valid_len = number;
+    } else if (key == "batch") {
+        batch = number;
+    } else if (key == "decode") {
+        decode = number;
+    } else if (key == "d_model") {
+        d_model = number;
+    } else if (key == "num_heads") {
+        num_heads = number;
+    } else if (key == "kv_heads") {
+        kv_heads = number;
+    } else if (key == "head_size") {
+        head_size = number;
+    } else if (key == "ff_size") {
+        ff_size = number;
+    } else if (key == "num_layers") {
+        num_layers = number;
+    } else if (key == "resident_layers") {
+        resident_layers = (int) number;
+    } else if (key == "weight_dir") {
+        weight_dir = value;
+    } else if (key == "sa_trace") {
+        sa_trace = value;
+    } else if (key == "sa_timeline") {
+        sa_timeline = value;
+    } else if (key == "backend" && (value == "sa" || value == "simd")) {
+        kernel.backend = (value == "sa") ? BACKEND_SA : BACKEND_SIMD;
+    } else if (key == "layout" && (value == "rwma" || value == "bwma")) {
+        kernel.bwma = (value == "bwma");
+    } else if (key == "sa_size") {
+        kernel.sa_size = (int) number;
+    } else if (key == "cores") {
+        kernel.core_num = (int) number;
+    } else if (key == "roi_depth") {
+        roi_depth = (int) number;
+    } else if (key == "peak_gops") {
+        peak_gops = number;
+    } else if (key == "peak_gbps") {
+        peak_gbps = number;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool ModelConfig::validate() const {
+    bool valid = true;
+    auto fail = [&valid](const std::string &message) {
+        std::cerr << "Invalid configuration: " << message << std::endl;
+        valid = false;
+    };
+
+    if (seq_len == 0 || d_model == 0 || num_heads == 0 || head_size == 0 || ff_size == 0 || num_layers == 0 ||
+        batch == 0)
+        fail("the dimensions must not be 0");
+    if (kv_heads > num_heads || (kv_heads != 0 && num_heads % kv_heads != 0))
+        fail("kv_heads must divide num_heads");
+    if (valid_len > seq_len)
+        fail("valid_len must not be larger than seq_len");
+    if (kernel.core_num < 1 || kernel.core_num > MAX_CORE_NUM)
+        fail("cores must be between 1 and " + std::to_string(MAX_CORE_NUM));
+    if (kernel.sa_size < 4 || kernel.sa_size % 4 != 0)
+        fail("sa_size must be a multiple of 4");
+    // The attention of a decoded token is a GEMM of one row: the NEON kernels only have tiles of 16 rows
+    if (decode > 0 && kernel.backend != BACKEND_SA)
+        fail("decode needs the SA backend");
+    if (!valid)
+        return false;
+
+    // Every dimension is tiled by the SA (or by the 16x16 tiles of the NEON kernels)
+    std::size_t tile = (kernel.backend == BACKEND_SIMD) ? 16 : kernel.sa_size;
+    if (kernel.backend == BACKEND_SIMD && kernel.bwma && kernel.sa_size != 16)
+        fail("the block-wise NEON kernels need sa_size 16");
+    for (std::size_t dim : {seq_len, d_model, head_size, ff_size}) {
+        if (dim % tile != 0)
+            fail(std::to_string(dim) + " is not a multiple of the " + std::to_string(tile) + "x" +
+                 std::to_string(tile) + " tiles");
+    }
+
+    // The L1/L2 tiling of the row-wise SA kernel must cover the weights of every GEMM (the key and value GEMMs of
+    // the attention have seq_len as one of their dimensions)
+    if (kernel.backend == BACKEND_SA && !kernel.bwma) {
+        std::pair<std::size_t, std::size_t> shapes[] = {{d_model, head_size}, {num_heads * head_size, d_model},
+                                                        {d_model, ff_size}, {ff_size, d_model},
+                                                        {head_size, seq_len}, {seq_len, head_size}};
+        for (auto &shape : shapes) {
+            if (!smmTilesRWMA(shape.first, shape.second, kernel.sa_size))
+                fail("the " + std::to_string(shape.first) + "x" + std::to_string(shape.second) +
+                     " weights cannot be tiled by the row-wise SA kernel");
+        }
+    }
+    return valid;
+}
+
+bool ModelConfig::usesWeight(int index) const {
+    std::size_t group = kv_heads ? num_heads / kv_heads : 1;
+    return index >= 3 * (int) num_heads || index % 3 == 0 || (index / 3) % group == 0;
+}
+
+void ModelConfig::print(std::ostream &os) const {
+    os << "Model: " << num_layers << " layers, seq_len " << seq_len << ", d_model " << d_model << ", "
+       << num_heads << " heads of " << head_size << ", ff_size " << ff_size << std::endl;
+    if (kv_heads != 0 && kv_heads != num_heads)
+        os << "Attention: " << kv_heads << " key/value heads, shared by " << num_heads / kv_heads << " heads each"
+           << std::endl;
+    if (batch > 1)
+        os << "Batch: " << batch << " sequences" << std::endl;
+    if (decode > 0)
+        os << "Decode: " << decode << " tokens" << std::endl;
+    if (valid_len != 0 && valid_len != seq_len)
+        os << "Input: " << valid_len << " tokens padded to " << seq_len << std::endl;
+    os << "Kernels: " << (kernel.backend == BACKEND_SA ? "SA" : "SIMD") << ", "
+       << (kernel.bwma ? "BWMA" : "RWMA") << ", SA size " << kernel.sa_size << ", " << kernel.core_num
+       << " cores" << std::endl;
+}
@@ -0,0 +1,51 @@
+//
+// Runtime configuration of the model shape and of the kernels, so that one binary covers a whole design-space
+// sweep. The defaults are the dimensions of transformer.h and the kernels of the compile-time flags; they are
+// overridden by a config file of `key = value` lines and by the command line:
+//   transformer [--config <file>] [--<key> <value>]... (or --<key>=<value>, with '-' or '_' in the keys)
+// Keys: seq_len, valid_len, batch, decode, d_model, num_heads, kv_heads, head_size, ff_size, num_layers, resident_layers, weight_dir,
+//       backend (sa|simd), layout (rwma|bwma), sa_size, cores, roi_depth, peak_gops, peak_gbps, sa_trace,
+//       sa_timeline
+//
+
+#ifndef FVLLMONTITRANSFORMER_MODELCONFIG_H
+#define FVLLMONTITRANSFORMER_MODELCONFIG_H
+
+#include "util.h"
+#include "../accelerator/kernel_registry.h"
+#include <ostream>
+
+struct ModelConfig {
+    std::size_t seq_len;
+    std::size_t valid_len; // tokens of the input, the rest of the seq_len rows is padding (0: no padding)
+    std::size_t batch;     // sequences computed together
+    std::size_t decode;    // tokens generated one at a time with a KV cache (0: one pass on the whole sequence)
+    std::size_t d_model;
+    std::size_t num_heads;
+    std::size_t kv_heads;  // key and value projections, shared by groups of heads (0: one per head)
+    std::size_t head_size;
+    std::size_t ff_size;
+    std::size_t num_layers;
+    int resident_layers; // layers whose weights are in memory at the same time when they are streamed
+    std::string weight_dir;
+    KernelConfig kernel;
+    int roi_depth;       // levels of the regions of interest that dump the gem5 statistics (see roi.h, 0: none)
+    std::size_t peak_gops; // peak throughput and memory bandwidth of the roofline of the blocks (0: not known)
+    std::size_t peak_gbps;
+    std::string sa_trace;  // file recording the SA instructions (DEVELOP builds, see sa_trace.h), empty for none
+    std::string sa_timeline; // Chrome trace of the states of the SA cores (DEVELOP builds, see sa_trace.h)
+
+    ModelConfig();
+
+    bool parseFile(const std::string& filename);
+    bool parseArgs(int argc, char** argv);
+    bool set(const std::string& key, const std::string& value);
+    // Checks that the shapes can be tiled by the selected kernels
+    bool validate() const;
+    // True if the weight at the given index of the weightVector of a layer is used: the key and value weights of
+    // a head sharing those of its group are not
+    bool usesWeight(int index) const;
+    void print(std::ostream& os) const;
+};
+
+#endif //FVLLMONTITRANSFORMER_MODELCONFIG_H
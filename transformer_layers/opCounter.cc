@@ -0,0 +1,124 @@
+//
+// Operation and traffic accounting, see opCounter.h
+//
+
+#include "opCounter.h"
+#include "../accelerator/kernel_registry.h"
+#include <algorithm>
+#include <iomanip>
+
+static const char *const kind_names[OP_KIND_NUM] = {"dense", "attention", "softmax", "addnorm", "transpose"};
+
+static OpCounts totals[OP_KIND_NUM];
+static double kind_seconds[OP_KIND_NUM];
+static std::size_t valid_rows_ = 1;
+static std::size_t rows_ = 1;
+static double peak_gops_ = 0;
+static double peak_gbps_ = 0;
+
+OpCounts &OpCounts::operator+=(const OpCounts &other) {
+    macs += other.macs;
+    padded_macs += other.padded_macs;
+    ops += other.ops;
+    param_writes += other.param_writes;
+    queues += other.queues;
+    streams += other.streams;
+    bytes_read += other.bytes_read;
+    bytes_written += other.bytes_written;
+    return *this;
+}
+
+OpCounts OpCounter::gemm(std::size_t rows, std::size_t input_size, std::size_t output_size, int64_t useful_macs) {
+    const KernelConfig &config = KernelRegistry::config();
+    bool sa = config.backend == BACKEND_SA;
+    uint64_t tile = sa ? config.sa_size : 16;
+    uint64_t all_macs = (uint64_t) rows * input_size * output_size;
+
+    OpCounts counts{};
+    counts.macs = useful_macs >= 0 ? (uint64_t) useful_macs : all_macs * valid_rows_ / rows_;
+    counts.padded_macs = all_macs - counts.macs;
+
+    // Each weight tile is loaded once per pass of rows: the whole batch in BWMA, and the blocks of 128 rows of
+    // smmComputeRWMA. The inputs are read once per tile of weight columns, and the outputs are accumulated once per
+    // tile of weight rows.
+    uint64_t weight_tiles = (input_size / tile) * (output_size / tile);
+    uint64_t passes = (sa && !config.bwma) ? (rows + 127) / 128 : 1;
+    counts.bytes_read = (uint64_t) input_size * output_size * passes +
+                        (uint64_t) rows * input_size * (output_size / tile) +
+                        (uint64_t) rows * output_size * (input_size / tile);
+    counts.bytes_written = (uint64_t) rows * output_size * (input_size / tile);
+
+    if (sa) {
+        // Every pass of r rows through a weight tile issues MAX_COL * (r + 2 * KERNEL_DIM - 1) - 1 queue and stream
+        // instructions, one stream per row and 2 * KERNEL_DIM - 2 more to drain the SA, whose beats are wasted
+        uint64_t max_col = tile / 4;
+        uint64_t tile_passes = weight_tiles * passes;
+        counts.param_writes = tile_passes * tile * max_col;
+        counts.streams = weight_tiles * rows + tile_passes * (2 * tile - 2);
+        counts.queues = weight_tiles * rows * max_col + tile_passes * (max_col * (2 * tile - 1) - 1) - counts.streams;
+        counts.padded_macs += tile_passes * (2 * tile - 2) * tile * tile;
+    }
+    return counts;
+}
+
+void OpCounter::setValidRows(std::size_t valid_rows, std::size_t rows) {
+    rows_ = std::max<std::size_t>(rows, 1);
+    valid_rows_ = std::min(valid_rows, rows_);
+}
+
+void OpCounter::add(OpKind kind, const OpCounts &counts, double seconds) {
+    totals[kind] += counts;
+    kind_seconds[kind] += seconds;
+}
+
+void OpCounter::reset() {
+    std::fill(totals, totals + OP_KIND_NUM, OpCounts{});
+    std::fill(kind_seconds, kind_seconds + OP_KIND_NUM, 0.0);
+}
+
+void OpCounter::setPeaks(double gops, double gbps) {
+    peak_gops_ = gops;
+    peak_gbps_ = gbps;
+}
+
+static void reportRow(std::ostream &os, const char *name, const OpCounts &counts, double seconds) {
+    uint64_t all_macs = counts.macs + counts.padded_macs;
+    double intensity = counts.bytes() ? (double) counts.usefulOps() / (double) counts.bytes() : 0.0;
+    double gops = seconds > 0 ? 1e-9 * (double) counts.usefulOps() / seconds : 0.0;
+    double gbps = seconds > 0 ? 1e-9 * (double) counts.bytes() / seconds : 0.0;
+    os << std::left << std::setw(11) << name << std::right << std::fixed << std::setprecision(1) << std::setw(10)
+       << 1e-6 * (double) counts.macs << std::setw(9)
+       << (all_macs ? 100.0 * (double) counts.padded_macs / (double) all_macs : 0.0) << std::setw(10)
+       << 1e-6 * (double) (counts.param_writes + counts.queues + counts.streams) << std::setw(10)
+       << 1e-6 * (double) counts.bytes() << std::setprecision(2) << std::setw(8) << intensity << std::setprecision(3)
+       << std::setw(11) << 1e3 * seconds << std::setw(9) << gops << std::setw(9) << gbps;
+    if (peak_gops_ > 0 && peak_gbps_ > 0) {
+        double attainable = std::min(peak_gops_, intensity * peak_gbps_);
+        os << std::setw(10) << attainable << (intensity * peak_gbps_ < peak_gops_ ? "  memory" : "  compute");
+    }
+    os << std::endl;
+}
+
+void OpCounter::report(std::ostream &os, double seconds) {
+    os << "Roofline:" << std::endl;
+    os << std::left << std::setw(11) << "layer" << std::right << std::setw(10) << "MMACs" << std::setw(9) << "pad %"
+       << std::setw(10) << "M SA ins" << std::setw(10) << "MB" << std::setw(8) << "op/B" << std::setw(11) << "time (ms)"
+       << std::setw(9) << "Gop/s" << std::setw(9) << "GB/s";
+    if (peak_gops_ > 0 && peak_gbps_ > 0)
+        os << std::setw(10) << "roof" << "  bound";
+    os << std::endl;
+    OpCounts all{};
+    for (int kind = 0; kind < OP_KIND_NUM; kind++) {
+        reportRow(os, kind_names[kind], totals[kind], kind_seconds[kind]);
+        all += totals[kind];
+    }
+    reportRow(os, "block", all, seconds);
+}
+
+OpCounter::Section::Section(OpKind kind, const OpCounts &counts) : kind_(kind), counts_(counts),
+                                                                   start_(std::chrono::steady_clock::now()) {}
+
+OpCounter::Section::~Section() {
+    std::chrono::duration<double> time = std::chrono::steady_clock::now() - start_;
+    OpCounter::add(kind_, counts_, time.count());
+}
@@ -0,0 +1,78 @@
+//
+// Operation and traffic accounting of the layers, for a roofline summary of each block. The counts are computed
+// from the shapes and the tiling of the selected kernels (see smm_gem.cc) when a layer runs, not counted in the
+// kernels; the time of each layer is measured around it.
+//   - macs: multiply-accumulates of the tokens; padded_macs: those of the padding rows (and masked keys) and, on
+//     the SA, of the pipeline fill and drain of every weight tile.
+//   - ops: element-wise operations of the other layers (softmax, add & norm, ...).
+//   - param_writes, queues, streams: SA instructions (smmParamWrite, smmQueue, smmStream).
+//   - bytes_read, bytes_written: memory traffic of the kernels, each word counted every time it is accessed by a
+//     tile (e.g. the GEMM outputs are accumulated, so read and written once per tile of weight rows).
+//
+
+#ifndef FVLLMONTITRANSFORMER_OPCOUNTER_H
+#define FVLLMONTITRANSFORMER_OPCOUNTER_H
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+enum OpKind {
+    OP_DENSE,     // weight GEMMs (query, key, value, condense, feed-forward)
+    OP_ATTENTION, // query x keys and scores x values GEMMs
+    OP_SOFTMAX,
+    OP_ADDNORM,
+    OP_TRANSPOSE,
+    OP_KIND_NUM
+};
+
+struct OpCounts {
+    uint64_t macs;
+    uint64_t padded_macs;
+    uint64_t ops;
+    uint64_t param_writes;
+    uint64_t queues;
+    uint64_t streams;
+    uint64_t bytes_read;
+    uint64_t bytes_written;
+
+    OpCounts &operator+=(const OpCounts &other);
+    // Operations of the tokens: 2 per MAC, and the element-wise ones
+    uint64_t usefulOps() const { return 2 * macs + ops; }
+    uint64_t bytes() const { return bytes_read + bytes_written; }
+};
+
+class OpCounter {
+public:
+    // Counts of a GEMM of the selected kernels on rows (all the sequences of the batch) x input_size by
+    // input_size x output_size. useful_macs are the MACs of the tokens; by default, the rows x input_size x
+    // output_size MACs in the proportion of the tokens set by setValidRows.
+    static OpCounts gemm(std::size_t rows, std::size_t input_size, std::size_t output_size,
+                         int64_t useful_macs = -1);
+    // Tokens among the rows given to the next layers (the rest is padding)
+    static void setValidRows(std::size_t valid_rows, std::size_t rows);
+
+    static void add(OpKind kind, const OpCounts &counts, double seconds);
+    static void reset();
+    // Counts, arithmetic intensity (useful ops per byte) and throughput of each kind of layer since the last
+    // reset(), and of all of them in seconds. With the peaks (setPeaks), the attainable throughput of the roofline
+    // and whether the layers are compute- or memory-bound.
+    static void report(std::ostream &os, double seconds);
+    // Peak throughput (Gop/s) and memory bandwidth (GB/s) of the platform, 0 if not known
+    static void setPeaks(double gops, double gbps);
+
+    // Adds the counts of a layer and the time until it is destroyed
+    class Section {
+    public:
+        Section(OpKind kind, const OpCounts &counts);
+        ~Section();
+        Section(const Section &) = delete;
+        Section &operator=(const Section &) = delete;
+    private:
+        OpKind kind_;
+        OpCounts counts_;
+        std::chrono::steady_clock::time_point start_;
+    };
+};
+
+#endif //FVLLMONTITRANSFORMER_OPCOUNTER_H
@@ -0,0 +1,203 @@
+//
+// Regions of interest, see roi.h
+//
+
+#include "roi.h"
+#include "../accelerator/sa_trace.h"
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <map>
+#include <vector>
+
+#ifndef DEVELOP
+#include <gem5/m5ops.h>
+#endif
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+struct Counters {
+    double seconds;
+    uint64_t cycles;
+    uint64_t instructions;
+};
+
+struct OpenRegion {
+    std::string path;
+    Counters start;
+};
+
+struct RegionTotals {
+    std::size_t order; // first begin, for the report
+    std::size_t count;
+    Counters total;
+};
+
+int max_depth = 2;
+std::vector<OpenRegion> open_regions;
+std::map<std::string, RegionTotals> totals;
+std::vector<std::string> dumps; // region (path) of every m5 statistics dump
+#ifndef DEVELOP
+uint64_t work_id = 0;
+#endif
+
+// Cycle and instruction counters of this process (and of the threads it starts afterwards), -1 if not available
+int perf_fd[2] = {-2, -2};
+
+#ifdef __linux__
+int openCounter(uint64_t config) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+uint64_t readCounter(int fd) {
+    uint64_t value = 0;
+#ifdef __linux__
+    if (fd >= 0 && read(fd, &value, sizeof(value)) != sizeof(value))
+        value = 0;
+#endif
+    return value;
+}
+
+Counters now() {
+    if (perf_fd[0] == -2) {
+#ifdef __linux__
+        perf_fd[0] = openCounter(PERF_COUNT_HW_CPU_CYCLES);
+        perf_fd[1] = openCounter(PERF_COUNT_HW_INSTRUCTIONS);
+#else
+        perf_fd[0] = perf_fd[1] = -1;
+#endif
+    }
+    timespec time{};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return {(double) time.tv_sec + 1e-9 * (double) time.tv_nsec, readCounter(perf_fd[0]), readCounter(perf_fd[1])};
+}
+
+// The statistics since the last reset belong to path alone
+void dumpStats(const std::string &path) {
+    dumps.push_back(path);
+#ifndef DEVELOP
+    m5_dump_reset_stats(0, 0);
+#endif
+}
+
+} // namespace
+
+void Roi::begin(const std::string &name) {
+    std::string path = open_regions.empty() ? name : open_regions.back().path + "/" + name;
+    int depth = (int) open_regions.size() + 1;
+    if (depth <= max_depth) {
+        if (depth == 1) {
+#ifndef DEVELOP
+            // The work item first, so that the statistics are reset after a switch to the detailed CPU (fs.py
+            // --roi-switch)
+            m5_work_begin(work_id, 0);
+            m5_reset_stats(0, 0);
+#endif
+        } else {
+            dumpStats(open_regions.back().path);
+        }
+    }
+    totals.insert({path, {totals.size(), 0, {0, 0, 0}}});
+    open_regions.push_back({path, now()});
+    // Regions of the timeline of the SA
+#ifdef DEVELOP
+    SaTimeline::region(path, true);
+#else
+    m5_trace_region(path.c_str());
+#endif
+}
+
+void Roi::end() {
+    if (open_regions.empty())
+        return;
+    Counters end = now();
+    const OpenRegion &region = open_regions.back();
+    RegionTotals &total = totals[region.path];
+    total.count++;
+    total.total.seconds += end.seconds - region.start.seconds;
+    total.total.cycles += end.cycles - region.start.cycles;
+    total.total.instructions += end.instructions - region.start.instructions;
+
+    int depth = (int) open_regions.size();
+    if (depth <= max_depth) {
+        dumpStats(region.path);
+#ifndef DEVELOP
+        if (depth == 1)
+            m5_work_end(work_id++, 0);
+#endif
+    }
+    // After the dump, which belongs to the region
+#ifdef DEVELOP
+    SaTimeline::region(region.path, false);
+#else
+    m5_trace_region(nullptr);
+#endif
+    open_regions.pop_back();
+}
+
+void Roi::tagTensor(const char *name, const void *data, std::size_t bytes) {
+#ifndef DEVELOP
+    m5_tensor_register(data, bytes, name);
+#else
+    (void) name;
+    (void) data;
+    (void) bytes;
+#endif
+}
+
+void Roi::setDepth(int depth) {
+    max_depth = depth;
+}
+
+void Roi::clear() {
+    if (!open_regions.empty())
+        return;
+    totals.clear();
+    dumps.clear();
+}
+
+void Roi::report(std::ostream &os) {
+    std::vector<const std::pair<const std::string, RegionTotals> *> regions(totals.size());
+    for (const auto &entry : totals) {
+        regions[entry.second.order] = &entry;
+    }
+    bool counters = perf_fd[0] >= 0;
+
+    os << "Regions of interest:" << std::endl;
+    os << std::left << std::setw(48) << "region" << std::right << std::setw(8) << "count" << std::setw(14)
+       << "time (ms)";
+    if (counters)
+        os << std::setw(16) << "cycles" << std::setw(8) << "IPC";
+    os << std::endl;
+    for (const auto *entry : regions) {
+        const RegionTotals &total = entry->second;
+        os << std::left << std::setw(48) << entry->first << std::right << std::setw(8) << total.count << std::fixed
+           << std::setprecision(3) << std::setw(14) << 1e3 * total.total.seconds;
+        if (counters) {
+            os << std::setw(16) << total.total.cycles << std::setprecision(2) << std::setw(8)
+               << (total.total.cycles ? (double) total.total.instructions / (double) total.total.cycles : 0.0);
+        }
+        os << std::endl;
+    }
+#ifndef DEVELOP
+    os << "Statistics dumps:" << std::endl;
+    for (std::size_t i = 0; i < dumps.size(); i++) {
+        os << std::setw(6) << i << "  " << dumps[i] << std::endl;
+    }
+#endif
+}
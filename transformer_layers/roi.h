@@ -0,0 +1,60 @@
+//
+// Regions of interest: named, nested regions of the code that are measured in place.
+//  - In gem5 builds (without -DDEVELOP), the regions call the m5 operations directly (util/m5/m5op_arm_A64.S, no
+//    shell or `m5` process in the simulated system): the statistics are reset when the outermost region begins and
+//    dumped when a region ends, and when a region begins inside another one (closing the part of the parent before
+//    it). Every dump is then the statistics of one region alone, without its children, and report() lists which
+//    region each dump belongs to. The outermost region is also a gem5 work item (m5_work_begin / m5_work_end).
+//    Only the regions up to setDepth() levels deep use the m5 operations; the deeper ones are part of their parent.
+//  - In every build, the regions are timed with clock_gettime and, on a Linux host that allows it, with the cycle
+//    and instruction counters of perf_event_open.
+// The names are joined with '/' into a path (e.g. "layer3/attention/head1/qk"); report() gives the count and the
+// totals of each path. The regions must begin and end on one thread (the kernels inside may be parallel).
+// With -DROI_DISABLE, ROI_BEGIN and ROI_END do nothing.
+// tagTensor() names the memory of the tensors for gem5 (m5_tensor_register), so that the TensorTrafficProbe of the
+// simulator splits the cache and memory traffic of the regions per tensor.
+//
+
+#ifndef FVLLMONTITRANSFORMER_ROI_H
+#define FVLLMONTITRANSFORMER_ROI_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+class Roi {
+public:
+    static void begin(const std::string &name);
+    static void end();
+
+    // Deepest level of the regions that use the m5 operations (1: the outermost ones only, 0: none). 2 by default.
+    static void setDepth(int depth);
+    // Count, time (and cycles, instructions) of every region path, and the region of every m5 statistics dump
+    static void report(std::ostream &os);
+    // Forgets the measurements (the regions must all be ended)
+    static void clear();
+
+    // The traffic of the memory of a tensor is counted under its name by gem5 until the memory is tagged again. The
+    // memory must be mapped (read or written once) before. Does nothing on the host.
+    static void tagTensor(const char *name, const void *data, std::size_t bytes);
+};
+
+// Ends the region when it goes out of scope
+class RoiScope {
+public:
+    explicit RoiScope(const std::string &name) { Roi::begin(name); }
+    ~RoiScope() { Roi::end(); }
+    RoiScope(const RoiScope &) = delete;
+    RoiScope &operator=(const RoiScope &) = delete;
+};
+
+#ifdef ROI_DISABLE
+#define ROI_BEGIN(name) ((void) 0)
+#define ROI_END() ((void) 0)
+#else
+#define ROI_BEGIN(name) Roi::begin(name)
+#define ROI_END() Roi::end()
+#endif
+
+#endif //FVLLMONTITRANSFORMER_ROI_H
@@ -1,87 +1,178 @@
 #include "selfattention.h"
 #include "memory.h"
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 //#include <cstdint>
 #include "debuggerFunctions.h"
+#include "opCounter.h"
+#include "roi.h"
 
 SingleHeadSelfAttn::SingleHeadSelfAttn(std::size_t pre_seq_len, std::size_t input_dim, std::size_t head_hidden_size,
-                                       uint32_t **weightVector, std::size_t kernel_dim, std::size_t max_col) {
+                                       uint32_t **weightVector, std::size_t kernel_dim, std::size_t max_col,
+                                       ActivationArena *arena, int step, int32_t **biasVector,
+                                       std::size_t max_batch, std::size_t max_context,
+                                       const SingleHeadSelfAttn *kv_source, int kv_last_step) {
 
     pre_seq_len_ = pre_seq_len;
     head_hidden_size_ = head_hidden_size;
     kernel_size_ = kernel_dim;
     max_col_ = max_col;
 
-    query_layer = new Dense(input_dim, head_hidden_size, weightVector[0]);
-    key_layer = new Dense(input_dim, head_hidden_size, weightVector[1]);
-    value_layer = new Dense(input_dim, head_hidden_size, weightVector[2]);
+    query_layer = new Dense(input_dim, head_hidden_size, weightVector[0], ACT_NONE,
+                            biasVector ? biasVector[0] : nullptr);
+    kv_source_ = kv_source ? kv_source : this;
+    key_layer = nullptr;
+    value_layer = nullptr;
+    if (kv_source == nullptr) {
+        key_layer = new Dense(input_dim, head_hidden_size, weightVector[1], ACT_NONE,
+                              biasVector ? biasVector[1] : nullptr);
+        value_layer = new Dense(input_dim, head_hidden_size, weightVector[2], ACT_NONE,
+                                biasVector ? biasVector[2] : nullptr);
+    }
     softmax = new Softmax();
 
-    query_layer_out = new uint32_t[pre_seq_len * head_hidden_size >> 2]();
-    key_layer_out = new uint32_t[pre_seq_len * head_hidden_size >> 2]();
-    key_transposed_layer_out = new uint32_t[pre_seq_len * head_hidden_size >> 2]();
-    value_layer_out = new uint32_t[pre_seq_len * head_hidden_size >> 2]();
-    attention_scores = new uint32_t[pre_seq_len * pre_seq_len >> 2]();
+    arena_ = arena;
+    // The projections hold the whole batch; the transposed keys and the scores only one sequence at a time (or the
+    // scores of one token for the whole context when decoding)
+    query_layer_out_id = arena->addTensor(max_batch * pre_seq_len * head_hidden_size >> 2, step, step, "query");
+    key_layer_out_id = -1;
+    value_layer_out_id = -1;
+    if (kv_source == nullptr) {
+        int kv_end = std::max(step, kv_last_step);
+        key_layer_out_id = arena->addTensor(max_batch * pre_seq_len * head_hidden_size >> 2, step, kv_end, "key");
+        value_layer_out_id = arena->addTensor(max_batch * pre_seq_len * head_hidden_size >> 2, step, kv_end, "value");
+    }
+    key_transposed_layer_out_id = arena->addTensor(pre_seq_len * head_hidden_size >> 2, step, step, "key_transposed");
+    std::size_t context = (max_context + kernel_dim - 1) / kernel_dim * kernel_dim;
+    attention_scores_id = arena->addTensor(std::max(pre_seq_len * pre_seq_len, context) >> 2, step, step, "scores");
 }
 
 SingleHeadSelfAttn::~SingleHeadSelfAttn() {
-
-    delete[] query_layer_out;
-    delete[] key_layer_out;
-    delete[] key_transposed_layer_out;
-    delete[] value_layer_out;
-    delete[] attention_scores;
-
     delete query_layer;
     delete key_layer;
     delete value_layer;
     delete softmax;
 }
 
-void SingleHeadSelfAttn::compute(std::size_t seq_len, uint32_t *input, uint32_t *output) {
-    query_layer->compute(seq_len, input, query_layer_out);
-    key_layer->compute(seq_len, input, key_layer_out);
-    value_layer->compute(seq_len, input, value_layer_out);
-
-
-#ifdef BWMA
-    std::cout << "BWMA method" << std::endl;
-    Transpose::transpose_rearranged(key_layer_out, key_transposed_layer_out, head_hidden_size_,
-                                    pre_seq_len_, kernel_size_, max_col_);
-#ifdef SIMD
-    simdComputeBWMA(seq_len, query_layer_out, attention_scores, key_transposed_layer_out,
-                          head_hidden_size_, seq_len);
-#else
-    smmComputeBWMA(seq_len, query_layer_out, attention_scores, key_transposed_layer_out, head_hidden_size_,
-                   seq_len);
-#endif
-    softmax->computeRearranged(attention_scores, seq_len, kernel_size_);
-#ifdef SIMD
-    simdComputeBWMA(seq_len, attention_scores, output, value_layer_out, seq_len, head_hidden_size_);
-#else
-    smmComputeBWMA(seq_len, attention_scores, output, value_layer_out, seq_len, head_hidden_size_);
-#endif
-#else
-    std::cout<< "RWMA method" << std::endl;
-    Transpose::transpose(key_layer_out, key_transposed_layer_out, head_hidden_size_,
-                                    pre_seq_len_);
-#ifdef SIMD
-    simdComputeRWMA(seq_len, query_layer_out, attention_scores, key_transposed_layer_out,
-               head_hidden_size_, seq_len);
-#else
-    smmComputeRWMA(seq_len, query_layer_out, attention_scores, key_transposed_layer_out,
-                head_hidden_size_, seq_len);
-#endif
-    softmax->compute(attention_scores, seq_len);
-#ifdef SIMD
-    simdComputeRWMA(seq_len, attention_scores, output, value_layer_out,
-               seq_len, head_hidden_size_);
-#else
-    smmComputeRWMA(seq_len, attention_scores, output, value_layer_out,
-                seq_len, head_hidden_size_);
-#endif
-#endif
-
-    softmax->post_softmax(output, seq_len, head_hidden_size_);
-}
\ No newline at end of file
+void SingleHeadSelfAttn::compute(std::size_t seq_len, uint32_t *input, uint32_t *output, std::size_t output_row_size,
+                                 std::size_t valid_len) {
+    computeBatch(1, seq_len, input, output, output_row_size, 0, &valid_len);
+}
+
+void SingleHeadSelfAttn::computeBatch(std::size_t batch, std::size_t seq_len, uint32_t *input, uint32_t *output,
+                                      std::size_t output_row_size, std::size_t output_stride,
+                                      const std::size_t *valid_lens) {
+    uint32_t* query_layer_out = arena_->get(query_layer_out_id);
+    uint32_t* key_layer_out = arena_->get(kv_source_->key_layer_out_id);
+    uint32_t* key_transposed_layer_out = arena_->get(key_transposed_layer_out_id);
+    uint32_t* value_layer_out = arena_->get(kv_source_->value_layer_out_id);
+    uint32_t* attention_scores = arena_->get(attention_scores_id);
+
+    // The GEMMs accumulate into their outputs, and the arena memory is shared with the other heads
+    ROI_BEGIN("qkv");
+    memset(query_layer_out, 0, batch * seq_len * head_hidden_size_);
+    query_layer->compute(seq_len, input, query_layer_out, batch);
+    if (kv_source_ == this) {
+        memset(key_layer_out, 0, batch * seq_len * head_hidden_size_);
+        memset(value_layer_out, 0, batch * seq_len * head_hidden_size_);
+        key_layer->compute(seq_len, input, key_layer_out, batch);
+        value_layer->compute(seq_len, input, value_layer_out, batch);
+    }
+    ROI_END();
+
+    bool bwma = KernelRegistry::config().bwma;
+    std::cout << (bwma ? "BWMA method" : "RWMA method") << std::endl;
+    std::size_t head_words = seq_len * head_hidden_size_ >> 2;
+    for (std::size_t b = 0; b < batch; b++) {
+        std::size_t valid_len = valid_lens ? valid_lens[b] : 0;
+        uint32_t* query = query_layer_out + b * head_words;
+        uint32_t* key = key_layer_out + b * head_words;
+        uint32_t* value = value_layer_out + b * head_words;
+        uint32_t* head_out = output + b * output_stride;
+
+        // Only the scores of the tokens with each other are useful
+        int64_t useful_macs = (int64_t) ((valid_len ? valid_len : seq_len) * (valid_len ? valid_len : seq_len) *
+                                         head_hidden_size_);
+        ROI_BEGIN("qk");
+        memset(attention_scores, 0, seq_len * seq_len);
+        if (bwma) {
+            Transpose::transpose_rearranged(key, key_transposed_layer_out, head_hidden_size_,
+                                            seq_len, kernel_size_, max_col_);
+        } else {
+            Transpose::transpose(key, key_transposed_layer_out, head_hidden_size_,
+                                 seq_len);
+        }
+        {
+            OpCounter::Section section(OP_ATTENTION,
+                                       OpCounter::gemm(seq_len, head_hidden_size_, seq_len, useful_macs));
+            if (bwma) {
+                KernelRegistry::computeBWMA(seq_len, query, attention_scores, key_transposed_layer_out,
+                                            head_hidden_size_, seq_len);
+            } else {
+                KernelRegistry::computeRWMA(seq_len, query, attention_scores, key_transposed_layer_out,
+                                            head_hidden_size_, seq_len);
+            }
+        }
+        ROI_END();
+
+        ROI_BEGIN("softmax");
+        if (bwma) {
+            softmax->computeRearranged(attention_scores, seq_len, kernel_size_, valid_len);
+        } else {
+            softmax->compute(attention_scores, seq_len, valid_len);
+        }
+        ROI_END();
+
+        ROI_BEGIN("sv");
+        {
+            OpCounter::Section section(OP_ATTENTION,
+                                       OpCounter::gemm(seq_len, seq_len, head_hidden_size_, useful_macs));
+            if (bwma) {
+                KernelRegistry::computeBWMA(seq_len, attention_scores, head_out, value, seq_len, head_hidden_size_);
+            } else {
+                KernelRegistry::computeRWMA(seq_len, attention_scores, head_out, value,
+                                            seq_len, head_hidden_size_, output_row_size);
+            }
+        }
+        softmax->post_softmax(head_out, seq_len, head_hidden_size_, output_row_size);
+        ROI_END();
+    }
+}
+
+void SingleHeadSelfAttn::computeStep(uint32_t *input, uint32_t *output, KVCache *cache) {
+    uint32_t* query = arena_->get(query_layer_out_id);
+    uint32_t* attention_scores = arena_->get(attention_scores_id);
+
+    memset(query, 0, head_hidden_size_);
+    query_layer->compute(1, input, query);
+    if (kv_source_ == this) {
+        uint32_t* key = arena_->get(key_layer_out_id);
+        uint32_t* value = arena_->get(value_layer_out_id);
+        memset(key, 0, head_hidden_size_);
+        memset(value, 0, head_hidden_size_);
+        key_layer->compute(1, input, key);
+        value_layer->compute(1, input, value);
+        cache->append(key, value);
+    }
+
+    // A single row is stored the same way in both arrangements, and the cache holds the keys and the values as
+    // block-wise weights: the GEMMs of the attention use the BWMA kernels on the first positions of the cache.
+    std::size_t context = cache->paddedLength();
+    int64_t useful_macs = (int64_t) (cache->length() * head_hidden_size_);
+    memset(attention_scores, 0, context);
+    {
+        OpCounter::Section section(OP_ATTENTION, OpCounter::gemm(1, head_hidden_size_, context, useful_macs));
+        KernelRegistry::computeBWMA(1, query, attention_scores, cache->keys(), head_hidden_size_, context);
+    }
+    softmax->computeRow(attention_scores, context, cache->length());
+    {
+        OpCounter::Section section(OP_ATTENTION, OpCounter::gemm(1, context, head_hidden_size_, useful_macs));
+        for (std::size_t j = 0; j < head_hidden_size_ / kernel_size_; j++) {
+            KernelRegistry::computeBWMA(1, attention_scores, output + j * max_col_, cache->values(j), context,
+                                        kernel_size_);
+        }
+    }
+
+    softmax->post_softmax(output, 1, head_hidden_size_);
+}
@@ -3,26 +3,50 @@
 #include "dense.h"
 #include "softmax.h"
 #include "transpose.h"
-#include "../accelerator/smm_gem.h"
+#include "activationArena.h"
+#include "kvCache.h"
+#include "../accelerator/kernel_registry.h"
 
 class SingleHeadSelfAttn{
     public:
+        // The intermediate buffers live in the arena during the given step; heads that run one after another share them.
+        // max_batch is the largest number of sequences given to computeBatch, max_context the largest KV cache given
+        // to computeStep (0: no decoding).
+        // Grouped-query attention: a head given a kv_source uses the keys and values of kv_source (which must run
+        // before it, with the same input) instead of computing its own, and has no key and value weights. The keys
+        // and values of a head stay in the arena until kv_last_step (-1: its own step) for the heads sharing them.
         SingleHeadSelfAttn(std::size_t pre_seq_len, std::size_t input_dim_, std::size_t head_hidden_size,
-                           uint32_t** weightVector, std::size_t , std::size_t);
+                           uint32_t** weightVector, std::size_t , std::size_t, ActivationArena* arena, int step,
+                           int32_t** biasVector = nullptr, std::size_t max_batch = 1, std::size_t max_context = 0,
+                           const SingleHeadSelfAttn* kv_source = nullptr, int kv_last_step = -1);
         ~SingleHeadSelfAttn();
-        void compute(std::size_t seq_len, uint32_t *input, uint32_t *output);
+        // In RWMA mode, output_row_size is the row pitch (in int8 elements) of the concatenated multi-head output.
+        // valid_len (0: seq_len) is the number of tokens of a right-padded sequence: the padded keys are masked.
+        void compute(std::size_t seq_len, uint32_t *input, uint32_t *output, std::size_t output_row_size = 0,
+                     std::size_t valid_len = 0);
+        // The query, key and value projections run on the whole batch (the sequences follow each other in input);
+        // the attention runs on each sequence. The output of sequence b is at output + b * output_stride words.
+        // valid_lens (nullptr: no padding) has one entry per sequence, as valid_len of compute().
+        void computeBatch(std::size_t batch, std::size_t seq_len, uint32_t *input, uint32_t *output,
+                          std::size_t output_row_size, std::size_t output_stride, const std::size_t *valid_lens);
+        // Attention of one new token (one row of input) to itself and to the previous tokens of cache: its key and
+        // value are appended to cache (unless the head shares the cache of its kv_source, which appends them). The
+        // output row is the same in both memory arrangements.
+        void computeStep(uint32_t *input, uint32_t *output, KVCache *cache);
 
     private:
         Dense* query_layer;
         Dense* key_layer;
         Dense* value_layer;
         Softmax* softmax;
+        const SingleHeadSelfAttn* kv_source_; // the head computing the keys and values (this one if not shared)
 
-        uint32_t* query_layer_out;
-        uint32_t* key_layer_out;
-        uint32_t* key_transposed_layer_out;
-        uint32_t* value_layer_out;
-        uint32_t* attention_scores;
+        ActivationArena* arena_;
+        int query_layer_out_id;
+        int key_layer_out_id;
+        int key_transposed_layer_out_id;
+        int value_layer_out_id;
+        int attention_scores_id;
 
         std::size_t pre_seq_len_;
         std::size_t head_hidden_size_;
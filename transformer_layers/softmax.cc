@@ -1,69 +1,121 @@
 #include "softmax.h"
+#include "opCounter.h"
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <iostream>
 
 static const  uint8_t  lookup[32] = {
         4, 5, 7, 8, 11, 14, 18, 23, 30, 38, 49, 63, 80, 103, 132, 170, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 2, 2, 3,
 };
 
+// The SA packs the int8 elements of a word from the most significant byte: the score of key j is in byte
+// 4 * (j / 4) + 3 - j % 4 of the row, and the keys past valid_len may share their word with valid ones.
+static inline bool validKey(std::size_t byte, std::size_t valid_len) {
+    return (byte & ~(std::size_t) 3) + 3 - (byte & 3) < valid_len;
+}
+
+// Each row is read and written twice (exponentials, then division by their sum); a valid score costs a lookup, an
+// addition and a division
+static OpCounts softmaxCounts(std::size_t rows, std::size_t valid_rows, std::size_t length, std::size_t valid_len) {
+    OpCounts counts{};
+    counts.ops = 3 * (uint64_t) valid_rows * valid_len;
+    counts.bytes_read = counts.bytes_written = 2 * (uint64_t) rows * length;
+    return counts;
+}
+
+static void softmaxRow(uint32_t *input, std::size_t length, std::size_t valid_len);
+
 Softmax::Softmax()= default;
 
 Softmax::~Softmax()= default;
 
-void Softmax::compute(uint32_t *input, std::size_t seq_len){
-    // We assume that the input value are fixed-point with 2 bits of fraction.
-    for (int i =0; i< seq_len; i++){
-        int32_t sum = 0;
-        auto* input_uptr = (uint8_t*) (input + i * (seq_len >> 2));
-
-        for (int j=0; j< seq_len; j++){
-            *(input_uptr) = lookup[(* (uint8_t *) input_uptr) >> 3]; // divide by the sqrt od the d_q which is sqrt(64) -> 8
-            sum += *(input_uptr);
-            input_uptr ++;
+void Softmax::compute(uint32_t *input, std::size_t seq_len, std::size_t valid_len){
+    // The keys past valid_len are padding (masked): their probability is 0, and so are the rows of padded queries.
+    valid_len = valid_len ? valid_len : seq_len;
+    OpCounter::Section section(OP_SOFTMAX, softmaxCounts(seq_len, valid_len, seq_len, valid_len));
+    for (std::size_t i =0; i< seq_len; i++){
+        uint32_t* row = input + i * (seq_len >> 2);
+        if (i >= valid_len) {
+            memset(row, 0, seq_len);
+            continue;
         }
-        sum = (sum==0) ? sum + 1 : sum;
-        input_uptr = (uint8_t*) (input + i * (seq_len >> 2));
-        for (int j=0; j< seq_len; j++){
-//            std::cout << "Ptr " << i << "\t: " << (int) *(input_ptr)  << std::endl;
-            *(input_uptr) = (uint8_t) ((*(input_uptr)) /(sum >> 8)); // divide the sum by 256 otherwise all the outputs will be 0!
-//            std::cout << "LUT " << i << "\t: " << (int) *(input_ptr) << std::endl;
-            input_uptr ++;
+        softmaxRow(row, seq_len, valid_len);
+    }
+}
+
+void Softmax::computeRow(uint32_t *input, std::size_t length, std::size_t valid_len){
+    valid_len = valid_len ? valid_len : length;
+    OpCounter::Section section(OP_SOFTMAX, softmaxCounts(1, 1, length, valid_len));
+    softmaxRow(input, length, valid_len);
+}
+
+static void softmaxRow(uint32_t *input, std::size_t length, std::size_t valid_len){
+    // We assume that the input value are fixed-point with 2 bits of fraction.
+    int32_t sum = 0;
+    auto* input_uptr = (uint8_t*) input;
+    for (std::size_t j=0; j< length; j++){
+        if (!validKey(j, valid_len)) {
+            *(input_uptr++) = 0;
+            continue;
         }
-//        input_uptr = (uint8_t*) (input + i * (seq_len >> 2));
-//        int sum_softmax = 0;
-//        for (int j=0; j< seq_len; j++)
-//            sum_softmax += *(input_uptr++);
+        *(input_uptr) = lookup[(* (uint8_t *) input_uptr) >> 3]; // divide by the sqrt od the d_q which is sqrt(64) -> 8
+        sum += *(input_uptr);
+        input_uptr ++;
+    }
+    int32_t divisor = std::max(1, sum >> 8); // divide the sum by 256 otherwise all the outputs will be 0!
+    input_uptr = (uint8_t*) input;
+    for (std::size_t j=0; j< length; j++){
+        *(input_uptr) = (uint8_t) ((*(input_uptr)) / divisor);
+        input_uptr ++;
     }
 }
 
-void Softmax::computeRearranged(uint32_t *input, std::size_t seq_len, std::size_t kernelDim) {
+void Softmax::computeRearranged(uint32_t *input, std::size_t seq_len, std::size_t kernelDim, std::size_t valid_len) {
     // We assume that the input value are fixed-point with 2 bits of fraction.
-    for (int i =0; i< seq_len; i++){
+    // Same masking as compute(): column j * kernelDim + k of row i is byte k of row i in column block j.
+    valid_len = valid_len ? valid_len : seq_len;
+    OpCounter::Section section(OP_SOFTMAX, softmaxCounts(seq_len, valid_len, seq_len, valid_len));
+    for (std::size_t i =0; i< seq_len; i++){
         int32_t sum = 0;
         auto* input_uptr = ((uint8_t*) input) + i * kernelDim;
         for (int j =0; j< seq_len / kernelDim; j++){
             for (int k=0; k< kernelDim; k++) {
+                if (i >= valid_len || !validKey(j * kernelDim + k, valid_len)) {
+                    *(input_uptr+k) = 0;
+                    continue;
+                }
                 *(input_uptr+k) = lookup[(* (uint8_t *) (input_uptr+ k)) >> 3]; // divide by the sqrt od the d_q which is sqrt(64) -> 8
                 sum += *(input_uptr+k);
             }
             input_uptr += seq_len* kernelDim;
         }
-        sum = (sum==0) ? sum + 1 : sum;
+        if (i >= valid_len)
+            continue;
+        int32_t divisor = std::max(1, sum >> 8);
         input_uptr = ((uint8_t*) input) + i * kernelDim;
         for (int j =0; j< seq_len / kernelDim; j++){
             for (int k=0; k< kernelDim; k++) {
-                *(input_uptr+k) = (uint8_t) ((*(input_uptr+k)) /(sum >> 8));
+                *(input_uptr+k) = (uint8_t) ((*(input_uptr+k)) / divisor);
             }
             input_uptr += seq_len* kernelDim;
         }
     }
 }
 
-void Softmax::post_softmax(uint32_t *input, std::size_t seq_len, std::size_t headSize){
-    auto* input_ptr = (int8_t*) input;
-    for (int i =0; i< seq_len * headSize; i++){
-        *input_ptr = (int8_t) (*(input_ptr) >> 6);
-        input_ptr++;
+void Softmax::post_softmax(uint32_t *input, std::size_t seq_len, std::size_t headSize, std::size_t rowSize){
+    // rowSize is the distance between two rows in int8 elements; 0 means the rows are packed (rowSize == headSize)
+    rowSize = rowSize ? rowSize : headSize;
+    OpCounts counts{};
+    counts.ops = (uint64_t) seq_len * headSize;
+    counts.bytes_read = counts.bytes_written = (uint64_t) seq_len * headSize;
+    OpCounter::Section section(OP_SOFTMAX, counts);
+    for (std::size_t i =0; i< seq_len; i++){
+        auto* input_ptr = ((int8_t*) input) + i * rowSize;
+        for (std::size_t j=0; j< headSize; j++){
+            *input_ptr = (int8_t) (*(input_ptr) >> 6);
+            input_ptr++;
+        }
     }
 }
 
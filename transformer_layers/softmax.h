@@ -15,10 +15,13 @@ class Softmax
     public:
         explicit Softmax();
         ~Softmax();
-        void compute(uint32_t *input, std::size_t seq_len);
+        // valid_len (0: seq_len) is the number of tokens of a right-padded sequence; the padded keys are masked
+        void compute(uint32_t *input, std::size_t seq_len, std::size_t valid_len = 0);
+        // One row of length scores, of which the first valid_len (0: length) are not masked
+        void computeRow(uint32_t *input, std::size_t length, std::size_t valid_len = 0);
         void computeFloat(uint32_t *input, std::size_t seq_len);
-        void computeRearranged(uint32_t *input, std::size_t seq_len, std::size_t kernelDim);
-        void post_softmax(uint32_t *input, size_t seq_len, size_t);
+        void computeRearranged(uint32_t *input, std::size_t seq_len, std::size_t kernelDim, std::size_t valid_len = 0);
+        void post_softmax(uint32_t *input, size_t seq_len, size_t, size_t rowSize = 0);
     private:
         int32_t float_to_fixed(float value, int32_t fractional_bits);
         float fixed_to_float(int32_t fixed_value, int32_t fractional_bits);
@@ -0,0 +1,186 @@
+//
+// Aligned, hugepage-capable tensors, see tensor.h
+//
+
+#include "tensor.h"
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <utility>
+
+static std::size_t roundUp(std::size_t size, std::size_t alignment) {
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+static std::size_t elementBytes(WeightDtype dtype) {
+    return dtype == DTYPE_INT32 ? sizeof(int32_t) : 1;
+}
+
+Tensor::Tensor() {
+    data_ = nullptr;
+    n_row_ = 0;
+    n_col_ = 0;
+    row_size_ = 0;
+    layout_ = LAYOUT_RWMA;
+    dtype_ = DTYPE_INT8X4;
+    allocated_ = 0;
+    mapped_ = false;
+    owner_ = false;
+}
+
+Tensor::Tensor(std::size_t n_row, std::size_t n_col, WeightLayout layout, TensorMemory memory, WeightDtype dtype)
+        : Tensor() {
+    n_row_ = n_row;
+    n_col_ = n_col;
+    row_size_ = n_col;
+    layout_ = layout;
+    dtype_ = dtype;
+    owner_ = true;
+
+    std::size_t size = std::max(bytes(), (std::size_t) TENSOR_ALIGNMENT);
+    std::size_t page = sysconf(_SC_PAGESIZE);
+    void *memory_ptr = nullptr;
+    if (memory == MEMORY_HUGEPAGE) {
+        allocated_ = roundUp(size, TENSOR_HUGEPAGE_SIZE);
+#ifdef MAP_HUGETLB
+        // Reserved hugepages (zeroed by the kernel), mapped now as the other tensors, which are cleared: the pages
+        // do not fault in the regions of interest, and gem5 can translate them (see Roi::tagTensor)
+        memory_ptr = mmap(nullptr, allocated_, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+        if (memory_ptr == MAP_FAILED) {
+            memory_ptr = nullptr;
+        } else {
+            mapped_ = true;
+        }
+#endif
+        if (memory_ptr == nullptr) {
+            // No reserved hugepages: ask for transparent hugepages on a hugepage-aligned region
+            memory_ptr = aligned_alloc(TENSOR_HUGEPAGE_SIZE, allocated_);
+#ifdef MADV_HUGEPAGE
+            if (memory_ptr != nullptr)
+                madvise(memory_ptr, allocated_, MADV_HUGEPAGE);
+#endif
+        }
+    } else if (memory == MEMORY_PAGE) {
+        allocated_ = roundUp(size, page);
+        memory_ptr = aligned_alloc(page, allocated_);
+    } else {
+        allocated_ = roundUp(size, TENSOR_ALIGNMENT);
+        memory_ptr = aligned_alloc(TENSOR_ALIGNMENT, allocated_);
+    }
+    if (memory_ptr == nullptr) {
+        std::cerr << "Error allocating a tensor of " << allocated_ << " bytes" << std::endl;
+        owner_ = false;
+        throw std::bad_alloc();
+    }
+    if (!mapped_)
+        memset(memory_ptr, 0, allocated_);
+    data_ = (uint32_t *) memory_ptr;
+}
+
+Tensor::Tensor(Tensor &&other) noexcept : Tensor() {
+    *this = std::move(other);
+}
+
+Tensor &Tensor::operator=(Tensor &&other) noexcept {
+    if (this != &other) {
+        release();
+        data_ = other.data_;
+        n_row_ = other.n_row_;
+        n_col_ = other.n_col_;
+        row_size_ = other.row_size_;
+        layout_ = other.layout_;
+        dtype_ = other.dtype_;
+        allocated_ = other.allocated_;
+        mapped_ = other.mapped_;
+        owner_ = other.owner_;
+        other.owner_ = false;
+    }
+    return *this;
+}
+
+Tensor::~Tensor() {
+    release();
+}
+
+void Tensor::release() {
+    if (owner_) {
+        if (mapped_) {
+            munmap(data_, allocated_);
+        } else {
+            free(data_);
+        }
+    }
+    owner_ = false;
+}
+
+Tensor Tensor::view(uint32_t *data, std::size_t n_row, std::size_t n_col, WeightLayout layout,
+                    std::size_t row_size, WeightDtype dtype) {
+    Tensor tensor;
+    tensor.data_ = data;
+    tensor.n_row_ = n_row;
+    tensor.n_col_ = n_col;
+    tensor.row_size_ = (row_size != 0 && layout == LAYOUT_RWMA) ? row_size : n_col;
+    tensor.layout_ = layout;
+    tensor.dtype_ = dtype;
+    return tensor;
+}
+
+Tensor Tensor::columns(std::size_t first_col, std::size_t n_col) const {
+    std::size_t col_words = first_col * elementBytes(dtype_) / sizeof(uint32_t);
+    if (layout_ == LAYOUT_BWMA) {
+        // The column blocks hold all the rows and follow each other
+        return view(data_ + col_words * n_row_, n_row_, n_col, layout_, 0, dtype_);
+    }
+    return view(data_ + col_words, n_row_, n_col, layout_, row_size_, dtype_);
+}
+
+uint32_t *Tensor::data() const {
+    return data_;
+}
+
+std::size_t Tensor::rows() const {
+    return n_row_;
+}
+
+std::size_t Tensor::cols() const {
+    return n_col_;
+}
+
+std::size_t Tensor::rowSize() const {
+    return row_size_;
+}
+
+std::size_t Tensor::words() const {
+    return (bytes() + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+}
+
+std::size_t Tensor::bytes() const {
+    return n_row_ * n_col_ * elementBytes(dtype_);
+}
+
+WeightLayout Tensor::layout() const {
+    return layout_;
+}
+
+WeightDtype Tensor::dtype() const {
+    return dtype_;
+}
+
+bool Tensor::owner() const {
+    return owner_;
+}
+
+void Tensor::touch() const {
+    std::size_t page = sysconf(_SC_PAGESIZE);
+    auto *bytes_ptr = (const volatile uint8_t *) data_;
+    for (std::size_t i = 0; i < bytes(); i += page) {
+        (void) bytes_ptr[i];
+    }
+    if (bytes() > 0)
+        (void) bytes_ptr[bytes() - 1];
+}
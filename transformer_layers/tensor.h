@@ -0,0 +1,81 @@
+//
+// Buffer of a matrix with its shape, dtype and memory arrangement. A Tensor either owns aligned storage (64 bytes,
+// a page, or hugepages for the multi-MB weights) or is a non-owning view of memory that belongs to somebody else
+// (the weight container, the activation arena, the slice of one head, ...). The layers and the kernels work on
+// data(), as before.
+//
+
+#ifndef FVLLMONTITRANSFORMER_TENSOR_H
+#define FVLLMONTITRANSFORMER_TENSOR_H
+
+#include "util.h"
+
+#define TENSOR_ALIGNMENT 64
+#define TENSOR_HUGEPAGE_SIZE (2 * 1024 * 1024)
+
+enum WeightLayout : uint32_t {
+    LAYOUT_RWMA = 0, // row-wise
+    LAYOUT_BWMA = 1, // block-wise: column blocks of SA_SIZE int8 columns, one after the other
+};
+
+enum WeightDtype : uint32_t {
+    DTYPE_INT8X4 = 0, // four int8 values packed in each uint32_t
+    DTYPE_TILE_MASK = 1, // one uint8_t per sa_size x sa_size tile, row-major over the tiles: 0 if all the weights are 0
+    DTYPE_INT32 = 2, // one int32_t per element (the biases)
+};
+
+enum TensorMemory {
+    MEMORY_ALIGNED,  // TENSOR_ALIGNMENT-byte aligned
+    MEMORY_PAGE,     // page aligned
+    MEMORY_HUGEPAGE, // MAP_HUGETLB if hugepages are reserved, transparent hugepages otherwise
+};
+
+class Tensor {
+public:
+    Tensor();
+    // Owning, zero-initialized tensor of n_row x n_col elements of the dtype (int8 elements for DTYPE_INT8X4)
+    Tensor(std::size_t n_row, std::size_t n_col, WeightLayout layout = LAYOUT_RWMA,
+           TensorMemory memory = MEMORY_ALIGNED, WeightDtype dtype = DTYPE_INT8X4);
+    Tensor(Tensor&& other) noexcept;
+    Tensor& operator=(Tensor&& other) noexcept;
+    Tensor(const Tensor&) = delete;
+    Tensor& operator=(const Tensor&) = delete;
+    ~Tensor();
+
+    // Non-owning view. row_size is the row pitch in elements of a row-wise tensor (0 for dense rows).
+    static Tensor view(uint32_t* data, std::size_t n_row, std::size_t n_col, WeightLayout layout = LAYOUT_RWMA,
+                       std::size_t row_size = 0, WeightDtype dtype = DTYPE_INT8X4);
+    // Non-owning view of the columns [first_col, first_col + n_col), e.g. the output of one head. For a
+    // block-wise tensor, first_col must be a multiple of the block size: the slice is then contiguous.
+    Tensor columns(std::size_t first_col, std::size_t n_col) const;
+
+    uint32_t* data() const;
+    std::size_t rows() const;
+    std::size_t cols() const;
+    // Row pitch in elements (cols() for block-wise tensors, whose slices are contiguous)
+    std::size_t rowSize() const;
+    // Size in uint32_t words (rounded up) and in bytes of the dense tensor, in elements of its dtype
+    std::size_t words() const;
+    std::size_t bytes() const;
+    WeightLayout layout() const;
+    WeightDtype dtype() const;
+    bool owner() const;
+    // Reads a byte of every page, so that the pages of a view of a file mapping are mapped (see Roi::tagTensor)
+    void touch() const;
+
+private:
+    void release();
+
+    uint32_t* data_;
+    std::size_t n_row_;
+    std::size_t n_col_;
+    std::size_t row_size_;
+    WeightLayout layout_;
+    WeightDtype dtype_;
+    // Size of the storage for an owning tensor; mapped_ is set if it comes from mmap
+    std::size_t allocated_;
+    bool mapped_;
+    bool owner_;
+};
+
+#endif //FVLLMONTITRANSFORMER_TENSOR_H
@@ -4,76 +4,253 @@
 
 #include "transformerBlock.h"
 #include "debuggerFunctions.h"
+#include "opCounter.h"
+#include "roi.h"
+#include <memory.h>
+#include <algorithm>
+#include <chrono>
 
 TransformerBlock::TransformerBlock(std::size_t pre_seq_len, std::size_t input_dim, std::size_t head_hidden_size,
                                    std::size_t num_heads, std::size_t ff_size, uint32_t ** weightVector,
-                                   std::size_t kernelDim, std::size_t maxCol) {
+                                   std::size_t kernelDim, std::size_t maxCol, int32_t ** biasVector,
+                                   ActivationArena* arena, int first_step, std::size_t max_batch,
+                                   std::size_t max_context, std::size_t num_kv_heads) {
+    // biasVector follows the same indexing as weightVector and may be nullptr (no bias at all)
+    // If an arena is given, the caller plans it once all its users are registered; otherwise the block owns one.
 
     num_heads_ = num_heads;
     head_hidden_size_ = head_hidden_size;
     input_dim_ = input_dim;
+    ff_size_ = ff_size;
+    weightVector_ = weightVector;
+    owns_arena_ = (arena == nullptr);
+    arena_ = owns_arena_ ? new ActivationArena() : arena;
 
+    // Steps of compute(): the heads run one after another, then the condense layer, the first add & norm,
+    // the two feed-forward layers and the last add & norm. The arena reuses memory between tensors that are
+    // not alive at the same step (e.g. the per-head buffers and the feed-forward intermediate tensor).
+    int condense_step = first_step + (int) num_heads;
+    int ff0_step = condense_step + 2;
+    int ff1_step = ff0_step + 1;
+    int last_step = ff1_step + 1;
+
+    // The keys and values of a group are kept until its last head has run
+    kv_group_size_ = num_heads / (num_kv_heads ? num_kv_heads : num_heads);
     for (int n =0; n< num_heads; n++){
-        selfatten[n] = new SingleHeadSelfAttn(pre_seq_len, input_dim, head_hidden_size, weightVector+n*3,
-                                              kernelDim, maxCol);
+        bool kv_owner = (n % kv_group_size_ == 0);
+        SingleHeadSelfAttn* kv_source = kv_owner ? nullptr : selfatten[n - n % kv_group_size_];
+        selfatten.push_back(new SingleHeadSelfAttn(pre_seq_len, input_dim, head_hidden_size, weightVector+n*3,
+                                                   kernelDim, maxCol, arena_, first_step + n,
+                                                   biasVector ? biasVector+n*3 : nullptr, max_batch,
+                                                   max_context, kv_source, first_step + n + (int) kv_group_size_ - 1));
+        if (max_context > 0 && kv_owner)
+            kv_caches_.push_back(new KVCache(max_context, head_hidden_size, kernelDim));
     }
 
-    condense = new Dense(num_heads* head_hidden_size, input_dim, weightVector[num_heads * 3]);
-
-    multihead_out = new uint32_t[pre_seq_len * num_heads * head_hidden_size >> 2]();
-    condense_out = new uint32_t[pre_seq_len * input_dim >> 2]();
-    intermediateFF = new uint32_t[pre_seq_len * ff_size >> 2]();
+    condense = new Dense(num_heads* head_hidden_size, input_dim, weightVector[num_heads * 3], ACT_NONE,
+                         biasVector ? biasVector[num_heads * 3] : nullptr);
 
-#ifndef BWMA
-    multihead_out_reshape = new uint32_t[pre_seq_len * num_heads * head_hidden_size >> 2]();
-#endif
+    std::size_t max_rows = max_batch * pre_seq_len;
+    multihead_out_id = arena_->addTensor(max_rows * num_heads * head_hidden_size >> 2, first_step, condense_step,
+                                         "attention_out");
+    condense_out_id = arena_->addTensor(max_rows * input_dim >> 2, condense_step, last_step, "condense_out");
+    intermediateFF_id = arena_->addTensor(max_rows * ff_size >> 2, ff0_step, ff1_step, "ff_intermediate");
+    if (owns_arena_)
+        arena_->plan();
 
     addNorm = new AddNormalize(pre_seq_len, input_dim, kernelDim, maxCol);
-    feedForward0 = new Dense(input_dim, ff_size, weightVector[num_heads * 3+ 1]);
-    feedForward1 = new Dense(ff_size, input_dim, weightVector[num_heads * 3 + 2]);
+    feedForward0 = new Dense(input_dim, ff_size, weightVector[num_heads * 3+ 1], ACT_GELU,
+                             biasVector ? biasVector[num_heads * 3 + 1] : nullptr);
+    feedForward1 = new Dense(ff_size, input_dim, weightVector[num_heads * 3 + 2], ACT_NONE,
+                             biasVector ? biasVector[num_heads * 3 + 2] : nullptr);
+
+    // The pointers of the weights do not change (see WeightStreamer): they are tagged once for gem5
+    for (std::size_t n = 0; n < num_heads; n++) {
+        for (int w = 0; w < 3; w++) {
+            if (w == 0 || n % kv_group_size_ == 0)
+                Roi::tagTensor("weights_qkv", weightVector[n * 3 + w], input_dim * head_hidden_size);
+        }
+    }
+    Roi::tagTensor("weights_condense", weightVector[num_heads * 3], num_heads * head_hidden_size * input_dim);
+    Roi::tagTensor("weights_ff0", weightVector[num_heads * 3 + 1], input_dim * ff_size);
+    Roi::tagTensor("weights_ff1", weightVector[num_heads * 3 + 2], ff_size * input_dim);
 }
 
-TransformerBlock::~TransformerBlock() = default;
+TransformerBlock::~TransformerBlock() {
+    for (std::size_t n = 0; n < num_heads_; n++) {
+        delete selfatten[n];
+    }
+    for (auto cache : kv_caches_) {
+        delete cache;
+    }
+    delete condense;
+    delete addNorm;
+    delete feedForward0;
+    delete feedForward1;
+    if (owns_arena_)
+        delete arena_;
+}
 
+int TransformerBlock::numSteps(std::size_t num_heads) {
+    return (int) num_heads + 5;
+}
 
-void TransformerBlock::compute(std::size_t seq_len, uint32_t *input, uint32_t *output) {
-    system("m5 resetstats");
+void TransformerBlock::prefetchWeights(std::size_t bytes) const {
+    // Touch the weights in the order compute() uses them (query, key and value of each head) without
+    // waiting for them, so that the memory accesses overlap with the work of the previous block.
+    for (int n = 0; n < 3 * (int) num_heads_ && bytes > 0; n++) {
+        if (n % 3 != 0 && (n / 3) % kv_group_size_ != 0)
+            continue; // shared keys and values
+        auto *weight_ptr = (const char *) weightVector_[n];
+        std::size_t size = std::min(bytes, input_dim_ * head_hidden_size_);
+        for (std::size_t i = 0; i < size; i += 64) {
+            __builtin_prefetch(weight_ptr + i, 0, 2);
+        }
+        bytes -= size;
+    }
+}
+
+
+void TransformerBlock::compute(std::size_t seq_len, uint32_t *input, uint32_t *output, const TransformerBlock* next,
+                               std::size_t valid_len) {
+    computeBatch(1, seq_len, input, output, &valid_len, next);
+}
+
+void TransformerBlock::computeBatch(std::size_t batch, std::size_t seq_len, uint32_t *input, uint32_t *output,
+                                    const std::size_t* valid_lens, const TransformerBlock* next) {
+    // The outputs of the condense and of the first feed-forward layer share the memory of the heads: they are got
+    // (and tagged for gem5) when they are used
+    uint32_t* multihead_out = arena_->get(multihead_out_id);
+    std::size_t rows = batch * seq_len;
+
+    // Operations and traffic of the layers of this block (see opCounter.h)
+    auto start = std::chrono::steady_clock::now();
+    std::size_t tokens = 0;
+    for (std::size_t b = 0; b < batch; b++) {
+        tokens += (valid_lens && valid_lens[b]) ? valid_lens[b] : seq_len;
+    }
+    OpCounter::reset();
+    OpCounter::setValidRows(tokens, rows);
+
+    // The GEMMs accumulate into their outputs, which share the arena memory
+    memset(multihead_out, 0, rows * num_heads_ * head_hidden_size_);
+    ROI_BEGIN("attention");
+    // Each head writes its column slice of the [seq_len, num_heads * head_hidden_size] output of each sequence. In
+    // BWMA, the column blocks are stored one after the other, so the slices are contiguous and the heads are already
+    // concatenated.
+    bool bwma = KernelRegistry::config().bwma;
+    std::size_t multihead_size = num_heads_ * head_hidden_size_;
+    Tensor multihead = Tensor::view(multihead_out, seq_len, multihead_size, bwma ? LAYOUT_BWMA : LAYOUT_RWMA);
     for (int n=0; n<num_heads_; n++){
         std::cout << "Head : " << n << std::endl;
-        selfatten[n]->compute(seq_len, input, multihead_out + n * (seq_len * head_hidden_size_ >> 2));
+        Tensor head = multihead.columns(n * head_hidden_size_, head_hidden_size_);
+        ROI_BEGIN("head" + std::to_string(n));
+        selfatten[n]->computeBatch(batch, seq_len, input, head.data(), head.rowSize(), seq_len * multihead_size >> 2,
+                                   valid_lens);
+        ROI_END();
     }
 
-#ifndef BWMA
-    Transpose::multihead_transpose(multihead_out, multihead_out_reshape,
-                                   seq_len, head_hidden_size_ >> 2, num_heads_);
-    multihead_out = multihead_out_reshape;
-#endif
-
     std::cout << "Condense"  << std::endl;
-    condense->compute(seq_len, multihead_out, condense_out);
+    ROI_BEGIN("condense");
+    uint32_t* condense_out = arena_->get(condense_out_id);
+    memset(condense_out, 0, rows * input_dim_);
+    condense->compute(seq_len, multihead_out, condense_out, batch);
+    ROI_END();
 
 
     std::cout << "Add Norm"  << std::endl;
-#ifdef BWMA
-    addNorm->computeRearranged(input, condense_out);
-#else
-    addNorm->compute(input, condense_out);
-#endif
-
-    system("m5 dumpresetstats");
+    ROI_BEGIN("addnorm");
+    addNormBatch(batch, seq_len, input, condense_out, valid_lens);
+    ROI_END();
+    ROI_END();
 
+    ROI_BEGIN("feedforward");
     std::cout << "Feed Forward 0"  << std::endl;
-    feedForward0->compute(seq_len, condense_out, intermediateFF);
+    ROI_BEGIN("ff0");
+    uint32_t* intermediateFF = arena_->get(intermediateFF_id);
+    memset(intermediateFF, 0, rows * ff_size_);
+    feedForward0->compute(seq_len, condense_out, intermediateFF, batch);
+    ROI_END();
 
     std::cout << "Feed Forward 1"  << std::endl;
-    feedForward1->compute(seq_len, intermediateFF, output);
+    ROI_BEGIN("ff1");
+    memset(output, 0, rows * input_dim_);
+    feedForward1->compute(seq_len, intermediateFF, output, batch);
+    ROI_END();
+
+    if (next != nullptr)
+        next->prefetchWeights(PREFETCH_BYTES);
 
     std::cout << "Add Norm"  << std::endl;
-#ifdef BWMA
-    addNorm->computeRearranged(condense_out, output);
-#else
-    addNorm->compute(condense_out, output);
-#endif
-    system("m5 dumpresetstats");
+    ROI_BEGIN("addnorm");
+    addNormBatch(batch, seq_len, condense_out, output, valid_lens);
+    ROI_END();
+    ROI_END();
+
+    std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+    OpCounter::report(std::cout, time.count());
+}
+
+bool TransformerBlock::computeStep(uint32_t *input, uint32_t *output, const TransformerBlock* next) {
+    if (cacheFull())
+        return false;
+    uint32_t* multihead_out = arena_->get(multihead_out_id);
+    OpCounter::setValidRows(1, 1);
+
+    // A single row is stored the same way in both arrangements: the head outputs are its consecutive slices
+    ROI_BEGIN("attention");
+    memset(multihead_out, 0, num_heads_ * head_hidden_size_);
+    for (std::size_t n=0; n<num_heads_; n++){
+        ROI_BEGIN("head" + std::to_string(n));
+        selfatten[n]->computeStep(input, multihead_out + (n * head_hidden_size_ >> 2),
+                                  kv_caches_[n / kv_group_size_]);
+        ROI_END();
+    }
+
+    uint32_t* condense_out = arena_->get(condense_out_id);
+    memset(condense_out, 0, input_dim_);
+    condense->compute(1, multihead_out, condense_out);
+    addNorm->compute(1, input, condense_out);
+    ROI_END();
+
+    ROI_BEGIN("feedforward");
+    uint32_t* intermediateFF = arena_->get(intermediateFF_id);
+    memset(intermediateFF, 0, ff_size_);
+    feedForward0->compute(1, condense_out, intermediateFF);
+    memset(output, 0, input_dim_);
+    feedForward1->compute(1, intermediateFF, output);
 
+    if (next != nullptr)
+        next->prefetchWeights(PREFETCH_BYTES);
+
+    addNorm->compute(1, condense_out, output);
+    ROI_END();
+    return true;
+}
+
+void TransformerBlock::clearCache() {
+    for (auto cache : kv_caches_) {
+        cache->clear();
+    }
+}
+
+std::size_t TransformerBlock::contextLength() const {
+    return kv_caches_.empty() ? 0 : kv_caches_[0]->length();
+}
+
+bool TransformerBlock::cacheFull() const {
+    return kv_caches_.empty() || kv_caches_[0]->length() == kv_caches_[0]->maxContext();
+}
+
+void TransformerBlock::addNormBatch(std::size_t batch, std::size_t seq_len, uint32_t *input, uint32_t *output,
+                                    const std::size_t* valid_lens) {
+    std::size_t words = seq_len * input_dim_ >> 2;
+    for (std::size_t b = 0; b < batch; b++) {
+        std::size_t valid_len = valid_lens ? valid_lens[b] : 0;
+        if (KernelRegistry::config().bwma) {
+            addNorm->computeRearranged(seq_len, input + b * words, output + b * words, valid_len);
+        } else {
+            addNorm->compute(seq_len, input + b * words, output + b * words, valid_len);
+        }
+    }
 }
@@ -4,39 +4,75 @@
 #include "selfattention.h"
 #include "addNorm.h"
 #include "dense.h"
+#include "activationArena.h"
 
 #ifndef FVLLMONTITRANSFORMER_MULTIHEADSELFATTENTION_H
 #define FVLLMONTITRANSFORMER_MULTIHEADSELFATTENTION_H
 
+// Weights of the next block prefetched while the current one finishes (about a quarter of a 1MB L2 cache)
+#define PREFETCH_BYTES (256 * 1024)
+
 class TransformerBlock{
 public:
+    // num_kv_heads (0: num_heads) is the number of key and value projections: the heads are split in num_kv_heads
+    // groups of consecutive heads (grouped-query attention, or multi-query attention with one group) that share the
+    // keys, the values and the KV cache of their first head. Only the first head of a group has key and value
+    // weights in weightVector; the entries of the others are not used (and may be nullptr).
     TransformerBlock(std::size_t pre_seq_len, std::size_t input_dim, std::size_t head_hidden_size, std::size_t num_heads,
                      std::size_t ff_size, uint32_t ** weightVector,
-                     std::size_t kernelDim, std::size_t maxCol);
+                     std::size_t kernelDim, std::size_t maxCol, int32_t ** biasVector = nullptr,
+                     ActivationArena* arena = nullptr, int first_step = 0, std::size_t max_batch = 1,
+                     std::size_t max_context = 0, std::size_t num_kv_heads = 0);
 
     virtual ~TransformerBlock();
 
-    void compute(std::size_t seq_len, uint32_t *input, uint32_t *output);
+    // next is the block that runs afterwards (if any); its first weights are prefetched during the last add & norm.
+    // valid_len (0: seq_len) is the number of tokens of a right-padded sequence: the attention masks the padded
+    // keys and the output rows of the padding are 0.
+    void compute(std::size_t seq_len, uint32_t *input, uint32_t *output, const TransformerBlock* next = nullptr,
+                 std::size_t valid_len = 0);
+    // batch (at most max_batch) sequences of seq_len rows, one after the other in input and output, each one in the
+    // memory arrangement of a single sequence. The weight GEMMs run once on the whole batch, so each weight tile is
+    // loaded once for all the sequences; the attention and the add & norm run on each sequence.
+    // valid_lens (nullptr: no padding) has one entry per sequence, as valid_len of compute().
+    void computeBatch(std::size_t batch, std::size_t seq_len, uint32_t *input, uint32_t *output,
+                      const std::size_t* valid_lens = nullptr, const TransformerBlock* next = nullptr);
+    // Decoding: one new token (one row of input and output) attending to the previous tokens given to computeStep
+    // since the last clearCache(). Its keys and values are kept in a KV cache of max_context tokens per head.
+    // Returns false if the cache is full.
+    bool computeStep(uint32_t *input, uint32_t *output, const TransformerBlock* next = nullptr);
+    void clearCache();
+    // Tokens in the KV cache
+    std::size_t contextLength() const;
+    bool cacheFull() const;
+    void prefetchWeights(std::size_t bytes) const;
+
+    // Number of arena steps used by a block, for blocks sharing the arena of a TransformerEncoder
+    static int numSteps(std::size_t num_heads);
 
 private:
+    // Add & norm of each sequence of the batch
+    void addNormBatch(std::size_t batch, std::size_t seq_len, uint32_t *input, uint32_t *output,
+                      const std::size_t* valid_lens);
+
     std::size_t num_heads_;
     std::size_t head_hidden_size_;
     std::size_t input_dim_;
     std::size_t ff_size_;
-    SingleHeadSelfAttn* selfatten[16];
-    uint32_t* multihead_out;
-    uint32_t* condense_out;
-    uint32_t* intermediateFF;
-    uint32_t* intermediateFFBlockWise;
+    std::vector<SingleHeadSelfAttn*> selfatten;
+    std::size_t kv_group_size_;       // heads per key and value projection
+    std::vector<KVCache*> kv_caches_; // one per group of heads, empty without max_context
+    ActivationArena* arena_;
+    bool owns_arena_;
+    int multihead_out_id;
+    int condense_out_id;
+    int intermediateFF_id;
+    uint32_t ** weightVector_;
     AddNormalize* addNorm;
     Dense* condense;
     Dense* feedForward0;
     Dense* feedForward1;
 
-#ifndef BWMA
-    uint32_t* multihead_out_reshape;
-#endif
-
 };
 
 #endif //FVLLMONTITRANSFORMER_MULTIHEADSELFATTENTION_H
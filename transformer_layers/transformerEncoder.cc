@@ -0,0 +1,164 @@
+//
+// Stack of TransformerBlocks sharing one activation arena.
+//
+
+#include "transformerEncoder.h"
+#include "layout.h"
+#include "roi.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory.h>
+
+TransformerEncoder::TransformerEncoder(std::size_t num_layers, std::size_t pre_seq_len, std::size_t input_dim,
+                                       std::size_t head_hidden_size, std::size_t num_heads, std::size_t ff_size,
+                                       uint32_t *** weightVectors, std::size_t kernelDim, std::size_t maxCol,
+                                       int32_t *** biasVectors, WeightStreamer* streamer, std::size_t max_batch,
+                                       std::size_t max_context, std::size_t num_kv_heads) {
+    input_dim_ = input_dim;
+    head_hidden_size_ = head_hidden_size;
+    max_col_ = maxCol;
+    streamer_ = streamer;
+
+    // The layers run one after another, so their steps follow each other in the arena and the intermediate
+    // tensors of all the layers share the same memory.
+    int layer_steps = TransformerBlock::numSteps(num_heads);
+    for (int l = 0; l < (int) num_layers; l++) {
+        layers_.push_back(new TransformerBlock(pre_seq_len, input_dim, head_hidden_size, num_heads, ff_size,
+                                               weightVectors[l], kernelDim, maxCol,
+                                               biasVectors ? biasVectors[l] : nullptr, &arena_, l * layer_steps,
+                                               max_batch, max_context, num_kv_heads));
+    }
+    for (int i = 0; i < 2; i++) {
+        ping_pong_id_[i] = arena_.addTensor(max_batch * pre_seq_len * input_dim >> 2, 0,
+                                            (int) num_layers * layer_steps, "block_io");
+    }
+    arena_.plan();
+}
+
+TransformerEncoder::~TransformerEncoder() {
+    for (auto layer : layers_) {
+        delete layer;
+    }
+}
+
+void TransformerEncoder::compute(std::size_t seq_len, uint32_t *input, uint32_t *output, std::size_t valid_len) {
+    computeBatch(1, seq_len, input, output, &valid_len);
+}
+
+void TransformerEncoder::resizeRows(std::size_t batch, const uint32_t *input, std::size_t in_rows, uint32_t *output,
+                                    std::size_t out_rows) const {
+    std::size_t row_words = input_dim_ >> 2;
+    for (std::size_t b = 0; b < batch; b++) {
+        const uint32_t *in = input + b * in_rows * row_words;
+        uint32_t *out = output + b * out_rows * row_words;
+        if (KernelRegistry::config().bwma) {
+            Layout::blockWiseResizeRows(in, in_rows, out, out_rows, row_words, max_col_);
+        } else {
+            std::size_t rows = std::min(in_rows, out_rows);
+            memcpy(out, in, rows * input_dim_);
+            memset(out + rows * row_words, 0, (out_rows - rows) * input_dim_);
+        }
+    }
+}
+
+void TransformerEncoder::computeBatch(std::size_t batch, std::size_t seq_len, uint32_t *input, uint32_t *output,
+                                      const std::size_t *valid_lens) {
+    uint32_t* ping_pong[2];
+    for (int i = 0; i < 2; i++) {
+        ping_pong[i] = arena_.get(ping_pong_id_[i]);
+    }
+
+    // The rows past length are only padding in all the sequences: they are dropped. In RWMA the first rows of a
+    // single sequence are a matrix of their own; in BWMA, or in a batch, the sequences must be repacked for length
+    // rows.
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::size_t> valid(batch, seq_len);
+    std::size_t tokens = 0;
+    std::size_t max_valid = 0;
+    for (std::size_t b = 0; b < batch; b++) {
+        if (valid_lens != nullptr && valid_lens[b] != 0)
+            valid[b] = valid_lens[b];
+        tokens += valid[b];
+        max_valid = std::max(max_valid, valid[b]);
+    }
+    std::size_t length = KernelRegistry::computeLength(max_valid, seq_len, head_hidden_size_);
+    bool repack = (KernelRegistry::config().bwma || batch > 1) && length != seq_len;
+    if (repack)
+        resizeRows(batch, input, seq_len, ping_pong[1], length);
+
+    int last = (int) layers_.size() - 1;
+    for (int l = 0; l <= last; l++) {
+        std::cout << "Layer : " << l << std::endl;
+        uint32_t* layer_in = (l == 0) ? (repack ? ping_pong[1] : input) : ping_pong[(l - 1) % 2];
+        uint32_t* layer_out = (l == last && !repack) ? output : ping_pong[l % 2];
+        const TransformerBlock* next = (l < last) ? layers_[l + 1] : nullptr;
+
+        auto layer_start = std::chrono::steady_clock::now();
+        if (streamer_)
+            streamer_->acquire(l);
+        ROI_BEGIN("layer" + std::to_string(l));
+        layers_[l]->computeBatch(batch, length, layer_in, layer_out, valid.data(), next);
+        ROI_END();
+        if (streamer_)
+            streamer_->release(l);
+        std::chrono::duration<double> layer_time = std::chrono::steady_clock::now() - layer_start;
+        std::cout << "Layer " << l << " time: " << layer_time.count() << " s" << std::endl;
+    }
+
+    if (repack) {
+        resizeRows(batch, ping_pong[last % 2], length, output, seq_len);
+    } else if (length < seq_len) {
+        memset(output + length * (input_dim_ >> 2), 0, (seq_len - length) * input_dim_);
+    }
+    std::chrono::duration<double> total_time = std::chrono::steady_clock::now() - start;
+
+    std::cout << "Encoder: " << layers_.size() << " layers, " << batch << " x " << seq_len << " rows, " << tokens
+              << " tokens (" << length << " rows per sequence computed), " << total_time.count() << " s, "
+              << (double) tokens / total_time.count() << " tokens/s" << std::endl;
+}
+
+bool TransformerEncoder::computeStep(uint32_t *input, uint32_t *output) {
+    uint32_t* ping_pong[2];
+    for (int i = 0; i < 2; i++) {
+        ping_pong[i] = arena_.get(ping_pong_id_[i]);
+    }
+
+    // All the layers have the same number of tokens in their caches
+    std::size_t position = contextLength();
+    if (layers_.empty() || layers_[0]->cacheFull()) {
+        std::cerr << "KV cache full at token " << position << std::endl;
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    int last = (int) layers_.size() - 1;
+    for (int l = 0; l <= last; l++) {
+        uint32_t* layer_in = (l == 0) ? input : ping_pong[(l - 1) % 2];
+        uint32_t* layer_out = (l == last) ? output : ping_pong[l % 2];
+        const TransformerBlock* next = (l < last) ? layers_[l + 1] : nullptr;
+
+        if (streamer_)
+            streamer_->acquire(l);
+        ROI_BEGIN("layer" + std::to_string(l));
+        layers_[l]->computeStep(layer_in, layer_out, next);
+        ROI_END();
+        if (streamer_)
+            streamer_->release(l);
+    }
+    std::chrono::duration<double> step_time = std::chrono::steady_clock::now() - start;
+
+    std::cout << "Decode: token " << position << ", context " << position + 1 << ", " << step_time.count() << " s"
+              << std::endl;
+    return true;
+}
+
+void TransformerEncoder::resetCache() {
+    for (auto layer : layers_) {
+        layer->clearCache();
+    }
+}
+
+std::size_t TransformerEncoder::contextLength() const {
+    return layers_.empty() ? 0 : layers_[0]->contextLength();
+}
@@ -0,0 +1,60 @@
+//
+// Stack of TransformerBlocks sharing one activation arena.
+//
+#include "transformerBlock.h"
+#include "activationArena.h"
+#include "weightStreamer.h"
+
+#ifndef FVLLMONTITRANSFORMER_TRANSFORMERENCODER_H
+#define FVLLMONTITRANSFORMER_TRANSFORMERENCODER_H
+
+class TransformerEncoder{
+public:
+    // weightVectors[l] (and biasVectors[l] if given) are the weightVector of layer l, see TransformerBlock.
+    // With a streamer, weightVectors[l] must be streamer->weightVector(l): each layer waits for its weights
+    // before running and gives its slot back to the streamer afterwards.
+    // max_batch is the largest number of sequences given to computeBatch, max_context the largest number of tokens
+    // decoded by computeStep (0: no decoding). num_kv_heads (0: num_heads) is the number of groups of heads sharing
+    // their keys and values, see TransformerBlock.
+    TransformerEncoder(std::size_t num_layers, std::size_t pre_seq_len, std::size_t input_dim,
+                       std::size_t head_hidden_size, std::size_t num_heads, std::size_t ff_size,
+                       uint32_t *** weightVectors, std::size_t kernelDim, std::size_t maxCol,
+                       int32_t *** biasVectors = nullptr, WeightStreamer* streamer = nullptr,
+                       std::size_t max_batch = 1, std::size_t max_context = 0, std::size_t num_kv_heads = 0);
+
+    virtual ~TransformerEncoder();
+
+    // valid_len (0: seq_len) is the number of tokens of a right-padded sequence. The padding is masked in the
+    // attention and the layers only run on the rows the kernels need (see KernelRegistry::computeLength), so a short
+    // sequence in a long slot costs about as much as its tokens; the output rows of the padding are 0.
+    void compute(std::size_t seq_len, uint32_t *input, uint32_t *output, std::size_t valid_len = 0);
+    // batch sequences of seq_len rows, one after the other in input and output (see TransformerBlock::computeBatch).
+    // valid_lens (nullptr: no padding) has one entry per sequence; the layers run on the rows needed by the longest.
+    void computeBatch(std::size_t batch, std::size_t seq_len, uint32_t *input, uint32_t *output,
+                      const std::size_t *valid_lens = nullptr);
+    // Autoregressive decoding: input and output are the row of one token, which attends to itself and to the
+    // tokens given to computeStep since the last resetCache() (see TransformerBlock::computeStep). Returns false if
+    // max_context tokens are already in the cache.
+    bool computeStep(uint32_t *input, uint32_t *output);
+    void resetCache();
+    // Tokens in the KV caches
+    std::size_t contextLength() const;
+
+private:
+    std::vector<TransformerBlock*> layers_;
+    ActivationArena arena_;
+    WeightStreamer* streamer_;
+    // Copies the first out_rows rows of each sequence (the rows past in_rows are 0)
+    void resizeRows(std::size_t batch, const uint32_t *input, std::size_t in_rows, uint32_t *output,
+                    std::size_t out_rows) const;
+
+    // The layers read from one buffer and write to the other. The first layer reads the encoder input and the last
+    // one writes the encoder output, unless the padding rows are dropped from a BWMA input or from a batch: then the
+    // input is repacked in ping_pong[1] and the output of the last layer is expanded from its buffer.
+    int ping_pong_id_[2];
+    std::size_t input_dim_;
+    std::size_t head_hidden_size_;
+    std::size_t max_col_;
+};
+
+#endif //FVLLMONTITRANSFORMER_TRANSFORMERENCODER_H
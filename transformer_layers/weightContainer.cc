@@ -0,0 +1,212 @@
+//
+// Binary weight container, see weightContainer.h
+//
+
+#include "weightContainer.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+WeightContainer::WeightContainer() {
+    mapping_ = nullptr;
+    size_ = 0;
+    entries_ = nullptr;
+    num_tensors_ = 0;
+}
+
+WeightContainer::~WeightContainer() {
+    if (mapping_ != nullptr)
+        munmap(mapping_, size_);
+}
+
+bool WeightContainer::open(const std::string &filename, bool verify) {
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Error opening weight container: " << filename << std::endl;
+        return false;
+    }
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(WeightFileHeader)) {
+        std::cerr << "Invalid weight container: " << filename << std::endl;
+        close(fd);
+        return false;
+    }
+    size_ = st.st_size;
+    // Private writable mapping: the pages are shared with the page cache until somebody writes them
+    void *mapping = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        std::cerr << "Error mapping weight container: " << filename << std::endl;
+        return false;
+    }
+    mapping_ = (uint8_t *) mapping;
+
+    auto *header = (const WeightFileHeader *) mapping_;
+    if (header->magic != WEIGHT_MAGIC || header->version != WEIGHT_VERSION ||
+        sizeof(WeightFileHeader) + header->num_tensors * sizeof(WeightTensorEntry) > size_) {
+        std::cerr << "Invalid weight container: " << filename << std::endl;
+        return false;
+    }
+    num_tensors_ = header->num_tensors;
+    entries_ = (const WeightTensorEntry *) (mapping_ + sizeof(WeightFileHeader));
+
+    for (uint32_t i = 0; i < num_tensors_; i++) {
+        const WeightTensorEntry &entry = entries_[i];
+        if (entry.offset % WEIGHT_ALIGNMENT != 0 || entry.offset + entry.bytes > size_) {
+            std::cerr << "Invalid tensor " << i << " in weight container: " << filename << std::endl;
+            return false;
+        }
+        if (verify && checksum(mapping_ + entry.offset, entry.bytes) != entry.checksum) {
+            std::cerr << "Checksum mismatch for tensor " << i << " in weight container: " << filename << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t WeightContainer::numTensors() const {
+    return num_tensors_;
+}
+
+const WeightTensorEntry *WeightContainer::entry(int i) const {
+    return &entries_[i];
+}
+
+uint8_t *WeightContainer::data(const WeightTensorEntry *entry) const {
+    return mapping_ + entry->offset;
+}
+
+const WeightTensorEntry *WeightContainer::find(int layer, int index) const {
+    for (uint32_t i = 0; i < num_tensors_; i++) {
+        if (entries_[i].layer == layer && entries_[i].index == index)
+            return &entries_[i];
+    }
+    return nullptr;
+}
+
+uint32_t *WeightContainer::tensor(int layer, int index) const {
+    const WeightTensorEntry *entry = find(layer, index);
+    return entry ? (uint32_t *) (mapping_ + entry->offset) : nullptr;
+}
+
+const uint8_t *WeightContainer::tileMask(int layer, int index) const {
+    const WeightTensorEntry *entry = find(layer, index | WEIGHT_INDEX_TILE_MASK);
+    return (entry && entry->dtype == DTYPE_TILE_MASK) ? mapping_ + entry->offset : nullptr;
+}
+
+const WeightTensorEntry *WeightContainer::findBias(int layer, int index) const {
+    const WeightTensorEntry *entry = find(layer, index | WEIGHT_INDEX_BIAS);
+    return (entry && entry->dtype == DTYPE_INT32 && entry->n_row == 1) ? entry : nullptr;
+}
+
+int32_t *WeightContainer::bias(int layer, int index) const {
+    const WeightTensorEntry *entry = findBias(layer, index);
+    return entry ? (int32_t *) (mapping_ + entry->offset) : nullptr;
+}
+
+void WeightContainer::evict(int layer, int index) const {
+    const WeightTensorEntry *entry = find(layer, index);
+    if (entry == nullptr)
+        return;
+    // Only the pages that hold nothing but this tensor, the neighbours may still be in use
+    std::size_t page = sysconf(_SC_PAGESIZE);
+    std::size_t begin = (entry->offset + page - 1) / page * page;
+    std::size_t end = (entry->offset + entry->bytes) / page * page;
+    if (end > begin)
+        madvise(mapping_ + begin, end - begin, MADV_DONTNEED);
+}
+
+uint32_t WeightContainer::checksum(const void *data, std::size_t bytes) {
+    // FNV-1a over 32-bit words, then over the remaining bytes
+    auto *words = (const uint32_t *) data;
+    uint32_t hash = 2166136261u;
+    for (std::size_t i = 0; i < bytes / sizeof(uint32_t); i++) {
+        hash = (hash ^ words[i]) * 16777619u;
+    }
+    for (std::size_t i = bytes / sizeof(uint32_t) * sizeof(uint32_t); i < bytes; i++) {
+        hash = (hash ^ ((const uint8_t *) data)[i]) * 16777619u;
+    }
+    return hash;
+}
+
+void WeightContainerWriter::add(int layer, int index, const uint32_t *data, int n_row, int n_col,
+                                WeightLayout layout, int sa_size) {
+    WeightTensorEntry entry{};
+    entry.layer = layer;
+    entry.index = index;
+    entry.n_row = n_row;
+    entry.n_col = n_col;
+    entry.layout = layout;
+    entry.sa_size = sa_size;
+    entry.dtype = DTYPE_INT8X4;
+    entry.bytes = (uint64_t) n_row * n_col;
+    entry.checksum = WeightContainer::checksum(data, entry.bytes);
+    entries_.push_back(entry);
+    data_.push_back(data);
+}
+
+void WeightContainerWriter::addTileMask(int layer, int index, const uint8_t *mask, int tile_rows, int tile_cols,
+                                        WeightLayout layout, int sa_size) {
+    WeightTensorEntry entry{};
+    entry.layer = layer;
+    entry.index = index | WEIGHT_INDEX_TILE_MASK;
+    entry.n_row = tile_rows;
+    entry.n_col = tile_cols;
+    entry.layout = layout;
+    entry.sa_size = sa_size;
+    entry.dtype = DTYPE_TILE_MASK;
+    entry.bytes = (uint64_t) tile_rows * tile_cols;
+    entry.checksum = WeightContainer::checksum(mask, entry.bytes);
+    entries_.push_back(entry);
+    data_.push_back(mask);
+}
+
+void WeightContainerWriter::addBias(int layer, int index, const int32_t *bias, int n_col) {
+    WeightTensorEntry entry{};
+    entry.layer = layer;
+    entry.index = index | WEIGHT_INDEX_BIAS;
+    entry.n_row = 1;
+    entry.n_col = n_col;
+    entry.layout = LAYOUT_RWMA;
+    entry.dtype = DTYPE_INT32;
+    entry.bytes = (uint64_t) n_col * sizeof(int32_t);
+    entry.checksum = WeightContainer::checksum(bias, entry.bytes);
+    entries_.push_back(entry);
+    data_.push_back(bias);
+}
+
+bool WeightContainerWriter::save(const std::string &filename) const {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file) {
+        std::cerr << "Error opening file for writing: " << filename << std::endl;
+        return false;
+    }
+
+    WeightFileHeader header{};
+    header.magic = WEIGHT_MAGIC;
+    header.version = WEIGHT_VERSION;
+    header.num_tensors = entries_.size();
+
+    std::vector<WeightTensorEntry> entries = entries_;
+    uint64_t offset = sizeof(WeightFileHeader) + entries.size() * sizeof(WeightTensorEntry);
+    for (auto &entry : entries) {
+        offset = (offset + WEIGHT_ALIGNMENT - 1) / WEIGHT_ALIGNMENT * WEIGHT_ALIGNMENT;
+        entry.offset = offset;
+        offset += entry.bytes;
+    }
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(WeightTensorEntry));
+    static const char padding[WEIGHT_ALIGNMENT] = {};
+    uint64_t position = sizeof(WeightFileHeader) + entries.size() * sizeof(WeightTensorEntry);
+    for (std::size_t i = 0; i < entries.size(); i++) {
+        file.write(padding, entries[i].offset - position);
+        file.write(reinterpret_cast<const char *>(data_[i]), entries[i].bytes);
+        position = entries[i].offset + entries[i].bytes;
+    }
+    return (bool) file;
+}
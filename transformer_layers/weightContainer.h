@@ -0,0 +1,93 @@
+//
+// Binary weight container. The file starts with a WeightFileHeader, followed by one WeightTensorEntry per tensor,
+// then the tensor data, each tensor starting at a WEIGHT_ALIGNMENT-byte boundary. A container is opened with mmap,
+// so that the weight pointers point straight into the mapping: nothing is parsed or copied at startup.
+//
+
+#ifndef FVLLMONTITRANSFORMER_WEIGHTCONTAINER_H
+#define FVLLMONTITRANSFORMER_WEIGHTCONTAINER_H
+
+#include "tensor.h"
+
+#define WEIGHT_MAGIC 0x54574153u // "SAWT"
+#define WEIGHT_VERSION 1
+#define WEIGHT_ALIGNMENT 64
+// The zero-tile mask of the tensor (layer, index) is stored as the tensor (layer, index | WEIGHT_INDEX_TILE_MASK).
+// The masks are metadata for external tools: the kernels do not read them.
+#define WEIGHT_INDEX_TILE_MASK 0x10000
+// The bias of the tensor (layer, index), if any, is stored as the DTYPE_INT32 tensor (layer, index | WEIGHT_INDEX_BIAS)
+// of 1 x n_col elements, n_col being the columns of the weights.
+#define WEIGHT_INDEX_BIAS 0x20000
+
+struct WeightFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t num_tensors;
+    uint32_t reserved[13];
+};
+
+struct WeightTensorEntry {
+    int32_t layer;       // -1 for the tensors that do not belong to a layer (e.g. the input)
+    int32_t index;       // index in the weightVector of the layer
+    uint32_t n_row;      // rows, in elements of the dtype (in tiles for DTYPE_TILE_MASK)
+    uint32_t n_col;      // columns, in elements of the dtype (in tiles for DTYPE_TILE_MASK)
+    uint32_t layout;     // WeightLayout
+    uint32_t sa_size;    // tile size of the block-wise layouts
+    uint32_t dtype;      // WeightDtype
+    uint32_t flags;      // reserved, 0
+    uint64_t offset;     // from the beginning of the file, multiple of WEIGHT_ALIGNMENT
+    uint64_t bytes;
+    uint32_t checksum;   // FNV-1a of the data
+    uint32_t reserved[3];
+};
+
+static_assert(sizeof(WeightFileHeader) == 64, "the header must keep the tensors aligned");
+static_assert(sizeof(WeightTensorEntry) == 64, "the entries must keep the tensors aligned");
+
+class WeightContainer {
+public:
+    WeightContainer();
+    ~WeightContainer();
+
+    // Maps the container. With verify, the checksum of every tensor is checked (this reads all the data).
+    bool open(const std::string& filename, bool verify = false);
+    uint32_t numTensors() const;
+    const WeightTensorEntry* entry(int i) const;
+    uint8_t* data(const WeightTensorEntry* entry) const;
+    // Returns the entry of the tensor, or nullptr if the container does not have it
+    const WeightTensorEntry* find(int layer, int index) const;
+    // Returns the data of the tensor in the mapping (copy-on-write), or nullptr if the container does not have it
+    uint32_t* tensor(int layer, int index) const;
+    // Returns the zero-tile mask of the tensor, or nullptr if the container does not have it
+    const uint8_t* tileMask(int layer, int index) const;
+    // Returns the entry of the bias of the tensor, or nullptr if the container does not have it
+    const WeightTensorEntry* findBias(int layer, int index) const;
+    // Returns the bias of the tensor in the mapping (copy-on-write), or nullptr if the container does not have it
+    int32_t* bias(int layer, int index) const;
+    // Drops the pages of the tensor from the mapping (they are read from the file again if the tensor is used)
+    void evict(int layer, int index) const;
+
+    static uint32_t checksum(const void* data, std::size_t bytes);
+
+private:
+    uint8_t* mapping_;
+    std::size_t size_;
+    const WeightTensorEntry* entries_;
+    uint32_t num_tensors_;
+};
+
+class WeightContainerWriter {
+public:
+    // The data is not copied: it must stay valid until save()
+    void add(int layer, int index, const uint32_t* data, int n_row, int n_col, WeightLayout layout, int sa_size);
+    void addTileMask(int layer, int index, const uint8_t* mask, int tile_rows, int tile_cols, WeightLayout layout,
+                     int sa_size);
+    void addBias(int layer, int index, const int32_t* bias, int n_col);
+    bool save(const std::string& filename) const;
+
+private:
+    std::vector<WeightTensorEntry> entries_;
+    std::vector<const void*> data_;
+};
+
+#endif //FVLLMONTITRANSFORMER_WEIGHTCONTAINER_H
@@ -0,0 +1,91 @@
+//
+// Weight streaming with a background thread, see weightStreamer.h
+//
+
+#include "weightStreamer.h"
+#include <algorithm>
+
+WeightStreamer::WeightStreamer(int num_layers, const std::vector<std::size_t> &tensor_words,
+                               int max_resident_layers, Loader loader, long passes) {
+    num_layers_ = num_layers;
+    num_slots_ = std::max(1, std::min(max_resident_layers, num_layers));
+    cyclic_ = num_slots_ < num_layers;
+    num_loads_ = cyclic_ ? std::max(1L, passes) * num_layers : num_layers;
+    loader_ = std::move(loader);
+    loaded_ = 0;
+    consumed_ = 0;
+    stop_ = false;
+
+    // One allocation per slot (on hugepages if it is large enough), every weight starting at an aligned offset
+    std::vector<std::size_t> offsets;
+    std::size_t slot_size = 0;
+    for (std::size_t words : tensor_words) {
+        offsets.push_back(slot_size);
+        slot_size += (words * sizeof(uint32_t) + TENSOR_ALIGNMENT - 1) / TENSOR_ALIGNMENT * TENSOR_ALIGNMENT;
+    }
+    for (int s = 0; s < num_slots_; s++) {
+        slot_memory_.emplace_back(1, slot_size, LAYOUT_RWMA,
+                                  slot_size >= TENSOR_HUGEPAGE_SIZE ? MEMORY_HUGEPAGE : MEMORY_ALIGNED);
+        auto *memory = (uint8_t *) slot_memory_.back().data();
+        slot_busy_.push_back(false);
+        slots_.emplace_back();
+        for (std::size_t offset : offsets) {
+            slots_.back().push_back((uint32_t *) (memory + offset));
+        }
+    }
+
+    thread_ = std::thread(&WeightStreamer::run, this);
+}
+
+WeightStreamer::~WeightStreamer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+}
+
+uint32_t **WeightStreamer::weightVector(int layer) {
+    return slots_[layer % num_slots_].data();
+}
+
+void WeightStreamer::acquire(int layer) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    // In cyclic mode the loads follow the order of use, otherwise layer l is the l-th load
+    cv_.wait(lock, [&] { return loaded_ > (cyclic_ ? consumed_ : layer); });
+}
+
+void WeightStreamer::release(int layer) {
+    if (!cyclic_)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        consumed_++;
+        slot_busy_[layer % num_slots_] = false;
+    }
+    cv_.notify_all();
+}
+
+void WeightStreamer::run() {
+    for (long load = 0; load < num_loads_; load++) {
+        int layer = (int) (load % num_layers_);
+        int slot = layer % num_slots_;
+        {
+            // Wait until the layer that used the slot before is released
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [&] { return stop_ || !slot_busy_[slot]; });
+            if (stop_)
+                return;
+            slot_busy_[slot] = true;
+        }
+
+        loader_(layer, weightVector(layer));
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            loaded_ = load + 1;
+        }
+        cv_.notify_all();
+    }
+}
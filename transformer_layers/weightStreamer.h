@@ -0,0 +1,56 @@
+//
+// Streams the weights of the layers with a background thread: a bounded pool of slots, each holding the weights of
+// one layer, is filled with the upcoming layers while the current one runs.
+//
+
+#ifndef FVLLMONTITRANSFORMER_WEIGHTSTREAMER_H
+#define FVLLMONTITRANSFORMER_WEIGHTSTREAMER_H
+
+#include "tensor.h"
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+class WeightStreamer {
+public:
+    // Fills weightVector (the slot of the layer, see weightVector()) with the weights of the layer
+    typedef std::function<void(int layer, uint32_t **weightVector)> Loader;
+
+    // tensor_words is the size of every weight of a layer, in uint32_t. At most max_resident_layers layers are
+    // in memory at any time; the layers are loaded again, in order, for each of the passes over the layers (e.g.
+    // the tokens of a decode), and no further: the last layers do not overlap with loads that are never used.
+    WeightStreamer(int num_layers, const std::vector<std::size_t> &tensor_words, int max_resident_layers,
+                   Loader loader, long passes = 1);
+    ~WeightStreamer();
+
+    // The weightVector of the slot used by the layer. The pointers never change, only the content of the slot,
+    // so the layers can be built once with them.
+    uint32_t **weightVector(int layer);
+    // The layers must be acquired and released in order (0, 1, ..., num_layers - 1, 0, 1, ...)
+    void acquire(int layer);
+    void release(int layer);
+
+private:
+    void run();
+
+    int num_layers_;
+    int num_slots_;
+    // If every layer fits in the pool, each one is loaded once and stays resident
+    bool cyclic_;
+    long num_loads_;
+    Loader loader_;
+    std::vector<Tensor> slot_memory_;
+    std::vector<std::vector<uint32_t *>> slots_;
+    // Slots holding a layer that is loaded, or being loaded, and not released yet
+    std::vector<bool> slot_busy_;
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    long loaded_;   // number of layer loads done by the background thread
+    long consumed_; // number of layers released
+    bool stop_;
+};
+
+#endif //FVLLMONTITRANSFORMER_WEIGHTSTREAMER_H